@@ -0,0 +1,135 @@
+/******************************************************************************
+*       SOFA, Simulation Open-Framework Architecture, development version     *
+*                (c) 2006-2019 INRIA, USTL, UJF, CNRS, MGH                    *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <NodePhysics/Checkpoint.h>
+
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define NODEPHYSICS_CHECKPOINT_MMAP
+#endif
+
+namespace nodephysics::checkpoint
+{
+
+Writer::Writer(const std::string& filename)
+    : m_buffer(1 << 20)
+{
+    m_out.rdbuf()->pubsetbuf(m_buffer.data(), (std::streamsize)m_buffer.size());
+    m_out.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+}
+
+void Writer::write(const void* data, std::size_t nbBytes)
+{
+    if (nbBytes == 0)
+        return;
+    m_out.write(static_cast<const char*>(data), (std::streamsize)nbBytes);
+    m_position += nbBytes;
+}
+
+bool Writer::close()
+{
+    m_out.close();
+    return !m_out.fail();
+}
+
+void Writer::align()
+{
+    static const char zeros[8] = {0,0,0,0,0,0,0,0};
+    write(zeros, (8 - m_position % 8) % 8);
+}
+
+Reader::Reader(const std::string& filename)
+{
+#ifdef NODEPHYSICS_CHECKPOINT_MMAP
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd >= 0)
+    {
+        struct stat st;
+        if (::fstat(fd, &st) == 0 && st.st_size > 0)
+        {
+            void* p = ::mmap(nullptr, (std::size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p != MAP_FAILED)
+            {
+                ::madvise(p, (std::size_t)st.st_size, MADV_SEQUENTIAL);
+                m_data = static_cast<const char*>(p);
+                m_size = (std::size_t)st.st_size;
+                m_mapped = true;
+            }
+        }
+        ::close(fd);
+    }
+    if (m_mapped)
+        return;
+#endif
+
+    std::ifstream in(filename, std::ios::in | std::ios::binary | std::ios::ate);
+    if (!in)
+        return;
+    m_buffer.resize((std::size_t)in.tellg());
+    in.seekg(0);
+    if (in.read(m_buffer.data(), (std::streamsize)m_buffer.size()))
+    {
+        m_data = m_buffer.data();
+        m_size = m_buffer.size();
+    }
+}
+
+Reader::~Reader()
+{
+#ifdef NODEPHYSICS_CHECKPOINT_MMAP
+    if (m_mapped)
+        ::munmap(const_cast<char*>(m_data), m_size);
+#endif
+}
+
+const char* Reader::view(std::size_t nbBytes)
+{
+    if (m_data == nullptr || m_overflow || nbBytes > m_size - m_position)
+    {
+        m_overflow = true;
+        return nullptr;
+    }
+    const char* p = m_data + m_position;
+    m_position += nbBytes;
+    return p;
+}
+
+bool Reader::read(void* data, std::size_t nbBytes)
+{
+    const char* p = view(nbBytes);
+    if (p == nullptr)
+        return false;
+    if (nbBytes > 0)
+        std::memcpy(data, p, nbBytes);
+    return true;
+}
+
+void Reader::align()
+{
+    view((8 - m_position % 8) % 8);
+}
+
+} // namespace nodephysics::checkpoint
@@ -0,0 +1,110 @@
+/******************************************************************************
+*       SOFA, Simulation Open-Framework Architecture, development version     *
+*                (c) 2006-2019 INRIA, USTL, UJF, CNRS, MGH                    *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <NodePhysics/config.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+/**
+ * Low-level support of the binary checkpoint files written by
+ * MechanicalObject::writeCheckpoint.
+ *
+ * A file is a sequence of raw values in the byte order of the machine which
+ * wrote it, each block of data starting on an 8 bytes boundary so that the
+ * values can be read in place from a memory-mapped file.
+ */
+namespace nodephysics::checkpoint
+{
+
+constexpr char Magic[8] = {'N','P','H','Y','S','C','K','P'};
+constexpr std::uint32_t Version = 1;
+constexpr std::uint32_t ByteOrderMark = 0x01020304u;
+/// Vector and matrix indices above this bound are rejected as corrupted.
+constexpr std::uint32_t MaxVectorIndex = 1024;
+
+/// Sequential writer of a checkpoint file.
+class SOFA_NODEPHYSICS_API Writer
+{
+public:
+    explicit Writer(const std::string& filename);
+
+    bool good() const { return m_out.good(); }
+
+    void write(const void* data, std::size_t nbBytes);
+
+    template <class T>
+    void writeValue(const T& value) { write(&value, sizeof(T)); }
+
+    /// Pad with zeros up to the next multiple of 8 bytes.
+    void align();
+
+    /// Flush the file, return false if any write failed.
+    bool close();
+
+private:
+    std::vector<char> m_buffer; ///< declared before the stream, which uses it until it is destroyed
+    std::ofstream m_out;
+    std::size_t m_position {0};
+};
+
+/// Sequential reader of a checkpoint file, memory-mapped when the platform allows it.
+class SOFA_NODEPHYSICS_API Reader
+{
+public:
+    explicit Reader(const std::string& filename);
+    ~Reader();
+
+    Reader(const Reader&) = delete;
+    Reader& operator=(const Reader&) = delete;
+
+    /// False if the file could not be opened, or if a read went past its end.
+    bool good() const { return m_data != nullptr && !m_overflow; }
+
+    /// Number of bytes left to read.
+    std::size_t remaining() const { return good() ? m_size - m_position : 0; }
+
+    /// Pointer to the next nbBytes of the file, or nullptr past its end.
+    const char* view(std::size_t nbBytes);
+
+    bool read(void* data, std::size_t nbBytes);
+
+    template <class T>
+    bool readValue(T& value) { return read(&value, sizeof(T)); }
+
+    /// Skip up to the next multiple of 8 bytes.
+    void align();
+
+private:
+    const char* m_data {nullptr};
+    std::size_t m_size {0};
+    std::size_t m_position {0};
+    bool m_overflow {false};
+    bool m_mapped {false};
+    std::vector<char> m_buffer; ///< file content when it cannot be mapped
+};
+
+} // namespace nodephysics::checkpoint
@@ -0,0 +1,95 @@
+/******************************************************************************
+*       SOFA, Simulation Open-Framework Architecture, development version     *
+*                (c) 2006-2019 INRIA, USTL, UJF, CNRS, MGH                    *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace nodephysics
+{
+
+/**
+ * @brief Set of modified indices of a vector, stored as sorted disjoint intervals.
+ *
+ * Adjacent or overlapping intervals are merged on insertion, so that writers
+ * modifying consecutive indices one at a time produce a single interval.
+ */
+class DirtyRanges
+{
+public:
+    typedef std::pair<std::size_t, std::size_t> Range; ///< [first,second)
+
+    /// Mark the indices [begin,end) as modified.
+    void add(std::size_t begin, std::size_t end)
+    {
+        if (begin >= end)
+            return;
+
+        // common case: indices modified in increasing order
+        if (m_ranges.empty() || m_ranges.back().second < begin)
+        {
+            m_ranges.emplace_back(begin, end);
+            return;
+        }
+        if (m_ranges.back().first <= begin)
+        {
+            m_ranges.back().second = std::max(m_ranges.back().second, end);
+            return;
+        }
+
+        // first range ending at or after begin, and first range starting after end
+        std::vector<Range>::iterator first = std::lower_bound(m_ranges.begin(), m_ranges.end(), begin,
+            [](const Range& r, std::size_t i) { return r.second < i; });
+        std::vector<Range>::iterator last = std::upper_bound(first, m_ranges.end(), end,
+            [](std::size_t i, const Range& r) { return i < r.first; });
+        if (first == last)
+        {
+            m_ranges.insert(first, Range(begin, end));
+            return;
+        }
+        first->first = std::min(first->first, begin);
+        first->second = std::max((last - 1)->second, end);
+        m_ranges.erase(first + 1, last);
+    }
+
+    void clear() { m_ranges.clear(); }
+
+    bool empty() const { return m_ranges.empty(); }
+
+    const std::vector<Range>& getRanges() const { return m_ranges; }
+
+    /// Total number of modified indices.
+    std::size_t getNbIndices() const
+    {
+        std::size_t n = 0;
+        for (const Range& r : m_ranges)
+            n += r.second - r.first;
+        return n;
+    }
+
+private:
+    std::vector<Range> m_ranges;
+};
+
+} // namespace nodephysics
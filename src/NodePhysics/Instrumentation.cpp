@@ -0,0 +1,101 @@
+/******************************************************************************
+*       SOFA, Simulation Open-Framework Architecture, development version     *
+*                (c) 2006-2019 INRIA, USTL, UJF, CNRS, MGH                    *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <NodePhysics/Instrumentation.h>
+
+#include <fstream>
+#include <sstream>
+
+namespace nodephysics::instrumentation
+{
+
+namespace
+{
+
+/// s as a JSON string literal.
+std::string quote(const std::string& s)
+{
+    std::string q = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\')
+            q += '\\';
+        q += c;
+    }
+    return q + "\"";
+}
+
+} // anonymous namespace
+
+ProbeSet::ProbeSet(const std::vector<std::string>& names)
+    : m_names(names)
+    , m_probes(new Probe[names.size()])
+{
+}
+
+void ProbeSet::reset()
+{
+    for (std::size_t i = 0; i < size(); ++i)
+    {
+        m_probes[i].calls = 0;
+        m_probes[i].cycles = 0;
+        m_probes[i].bytes = 0;
+    }
+}
+
+void ProbeSet::getValues(std::vector<unsigned long>& calls, std::vector<unsigned long>& cycles, std::vector<unsigned long>& bytes) const
+{
+    calls.resize(size());
+    cycles.resize(size());
+    bytes.resize(size());
+    for (std::size_t i = 0; i < size(); ++i)
+    {
+        calls[i] = (unsigned long)m_probes[i].calls.load(std::memory_order_relaxed);
+        cycles[i] = (unsigned long)m_probes[i].cycles.load(std::memory_order_relaxed);
+        bytes[i] = (unsigned long)m_probes[i].bytes.load(std::memory_order_relaxed);
+    }
+}
+
+std::string ProbeSet::toJSON() const
+{
+    std::ostringstream out;
+    out << "{";
+    for (std::size_t i = 0; i < size(); ++i)
+    {
+        out << (i ? ", " : "") << quote(m_names[i])
+            << ": {\"calls\": " << m_probes[i].calls.load(std::memory_order_relaxed)
+            << ", \"cycles\": " << m_probes[i].cycles.load(std::memory_order_relaxed)
+            << ", \"bytes\": " << m_probes[i].bytes.load(std::memory_order_relaxed) << "}";
+    }
+    out << "}";
+    return out.str();
+}
+
+bool appendJSON(const std::string& filename, const std::string& component, const ProbeSet& probes)
+{
+    std::ofstream file(filename, std::ios::app);
+    if (!file)
+        return false;
+    file << "{\"component\": " << quote(component) << ", \"probes\": " << probes.toJSON() << "}\n";
+    return (bool)file;
+}
+
+} // namespace nodephysics::instrumentation
@@ -0,0 +1,136 @@
+/******************************************************************************
+*       SOFA, Simulation Open-Framework Architecture, development version     *
+*                (c) 2006-2019 INRIA, USTL, UJF, CNRS, MGH                    *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <NodePhysics/config.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#  include <x86intrin.h>
+#  define NODEPHYSICS_HAVE_TSC
+#else
+#  include <chrono>
+#endif
+
+/**
+ * Call counts, cycles and bytes touched by the hot paths of the components.
+ *
+ * A component owns a ProbeSet with one Probe per instrumented function, and
+ * opens a NODEPHYSICS_PROBE at the start of each of them. The probes are only
+ * compiled in when NODEPHYSICS_INSTRUMENTATION is defined (CMake option of the
+ * same name): otherwise NODEPHYSICS_PROBE expands to nothing and its byte count
+ * is not evaluated, and the statistics of the components stay at 0.
+ *
+ * Cycles are read from the time stamp counter on x86, and are nanoseconds of
+ * a steady clock elsewhere. Bytes are estimates of the state memory read and
+ * written by the call.
+ */
+namespace nodephysics::instrumentation
+{
+
+/// Current value of the time stamp counter.
+inline std::uint64_t readCycles()
+{
+#ifdef NODEPHYSICS_HAVE_TSC
+    return __rdtsc();
+#else
+    return (std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/// Statistics of one instrumented function, which may be called from several threads.
+struct Probe
+{
+    std::atomic<std::uint64_t> calls {0};
+    std::atomic<std::uint64_t> cycles {0};
+    std::atomic<std::uint64_t> bytes {0};
+};
+
+/// The probes of one component, identified by their index in the list of names.
+class SOFA_NODEPHYSICS_API ProbeSet
+{
+public:
+    explicit ProbeSet(const std::vector<std::string>& names);
+
+    std::size_t size() const { return m_names.size(); }
+    const std::vector<std::string>& getNames() const { return m_names; }
+
+    Probe& operator[](std::size_t i) { return m_probes[i]; }
+    const Probe& operator[](std::size_t i) const { return m_probes[i]; }
+
+    void reset();
+
+    /// One value per probe, in the order of the names.
+    void getValues(std::vector<unsigned long>& calls, std::vector<unsigned long>& cycles, std::vector<unsigned long>& bytes) const;
+
+    /// {"name": {"calls": ..., "cycles": ..., "bytes": ...}, ...}
+    std::string toJSON() const;
+
+private:
+    std::vector<std::string> m_names;
+    std::unique_ptr<Probe[]> m_probes;
+};
+
+/// Adds the cycles spent between its construction and its destruction, and the given bytes, to a probe.
+class ScopedProbe
+{
+public:
+    ScopedProbe(Probe& probe, std::uint64_t bytes)
+        : m_probe(probe), m_bytes(bytes), m_start(readCycles())
+    {
+    }
+
+    ~ScopedProbe()
+    {
+        m_probe.cycles.fetch_add(readCycles() - m_start, std::memory_order_relaxed);
+        m_probe.calls.fetch_add(1, std::memory_order_relaxed);
+        m_probe.bytes.fetch_add(m_bytes, std::memory_order_relaxed);
+    }
+
+    ScopedProbe(const ScopedProbe&) = delete;
+    ScopedProbe& operator=(const ScopedProbe&) = delete;
+
+private:
+    Probe& m_probe;
+    const std::uint64_t m_bytes;
+    const std::uint64_t m_start;
+};
+
+/// Append {"component": component, "probes": probes.toJSON()} as one line to the file.
+/// Returns false if the file cannot be written.
+SOFA_NODEPHYSICS_API bool appendJSON(const std::string& filename, const std::string& component, const ProbeSet& probes);
+
+} // namespace nodephysics::instrumentation
+
+/// Record the current scope in probe index of probes. bytes is not evaluated without instrumentation.
+#ifdef NODEPHYSICS_INSTRUMENTATION
+#  define NODEPHYSICS_PROBE(probes, index, bytes) \
+    ::nodephysics::instrumentation::ScopedProbe nodephysicsScopedProbe((probes)[index], (std::uint64_t)(bytes))
+#else
+#  define NODEPHYSICS_PROBE(probes, index, bytes) ((void)0)
+#endif
@@ -38,7 +38,13 @@ int MechanicalObjectClass = core::RegisterObject("State vectors")
         .add< MechanicalObject<Vec1Types> >()
         .add< MechanicalObject<Vec6Types> >()
         .add< MechanicalObject<Rigid3Types> >()
-        .add< MechanicalObject<Rigid2Types> >();
+        .add< MechanicalObject<Rigid2Types> >()
+        .add< MechanicalObject<Vec3fTypes> >()
+        .add< MechanicalObject<Vec2fTypes> >()
+        .add< MechanicalObject<Vec1fTypes> >()
+        .add< MechanicalObject<Vec6fTypes> >()
+        .add< MechanicalObject<Rigid3fTypes> >()
+        .add< MechanicalObject<Rigid2fTypes> >();
 
 // template specialization must be in the same namespace as original namespace for GCC 4.1
 // g++ 4.1 requires template instantiations to be declared on a parent namespace from the template class.
@@ -48,202 +54,346 @@ template class SOFA_BASE_MECHANICS_API MechanicalObject<Vec1Types>;
 template class SOFA_BASE_MECHANICS_API MechanicalObject<Vec6Types>;
 template class SOFA_BASE_MECHANICS_API MechanicalObject<Rigid3Types>;
 template class SOFA_BASE_MECHANICS_API MechanicalObject<Rigid2Types>;
+template class SOFA_BASE_MECHANICS_API MechanicalObject<Vec3fTypes>;
+template class SOFA_BASE_MECHANICS_API MechanicalObject<Vec2fTypes>;
+template class SOFA_BASE_MECHANICS_API MechanicalObject<Vec1fTypes>;
+template class SOFA_BASE_MECHANICS_API MechanicalObject<Vec6fTypes>;
+template class SOFA_BASE_MECHANICS_API MechanicalObject<Rigid3fTypes>;
+template class SOFA_BASE_MECHANICS_API MechanicalObject<Rigid2fTypes>;
+
+namespace
+{
 
+/// Number of scalars of a Rigid3 coordinate.
+constexpr std::size_t RigidSize = 7;
 
+} // anonymous namespace
 
+// Implementations of the Rigid3 specializations, shared by the double and float types.
+// With a flat Coord layout and a FullVector source, the updates go through the
+// batched rigid kernels.
+template<class DataTypes>
+struct MechanicalObject<DataTypes>::Rigid3Impl
+{
+    static void applyRotation(MechanicalObject<DataTypes>& mo, const defaulttype::Quat q)
+    {
+        typedef typename DataTypes::VecCoord VecCoord;
+        typedef typename DataTypes::Real Real;
 
+        helper::WriteAccessor< Data<VecCoord> > x_wA = *mo.write(core::VecCoordId::position());
+        VecCoord& x = x_wA.wref();
+        const helper::Quater<Real> qr((Real)q[0], (Real)q[1], (Real)q[2], (Real)q[3]);
+        const bool normalize = mo.d_normalizeOrientations.getValue();
 
+        if constexpr (hasScalarLayout<typename DataTypes::Coord, Real>())
+        {
+            Real* px = flatData(x);
+            const Real pq[4] = { qr[0], qr[1], qr[2], qr[3] };
+            mo.parallelForDofs(x.size(), [&](std::size_t begin, std::size_t end)
+            {
+                kernels::rigidRotate(px + begin * RigidSize, pq, end - begin, normalize);
+            });
+            return;
+        }
 
-template<>
-void MechanicalObject<defaulttype::Rigid3Types>::applyRotation (const defaulttype::Quat q)
-{
-    helper::WriteAccessor< Data<VecCoord> > x = *this->write(core::VecCoordId::position());
-
-    for (unsigned int i = 0; i < x.size(); i++)
-    {
-        x[i].getCenter() = q.rotate(x[i].getCenter());
-        x[i].getOrientation() = q * x[i].getOrientation();
+        mo.parallelForDofs(x.size(), [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; i++)
+            {
+                x[i].getCenter() = qr.rotate(x[i].getCenter());
+                x[i].getOrientation() = qr * x[i].getOrientation();
+                if (normalize)
+                    x[i].getOrientation().normalize();
+            }
+        });
     }
-}
-
-template<>
-void MechanicalObject<defaulttype::Rigid3Types>::addFromBaseVectorDifferentSize(core::VecId dest, const defaulttype::BaseVector* src, unsigned int &offset )
-{
 
-    if (dest.type == sofa::core::V_COORD)
+    static void addFromBaseVectorDifferentSize(MechanicalObject<DataTypes>& mo, core::VecId dest, const defaulttype::BaseVector* src, unsigned int &offset )
     {
+        typedef typename DataTypes::Coord Coord;
+        typedef typename DataTypes::Deriv Deriv;
+        typedef typename DataTypes::VecCoord VecCoord;
+        typedef typename DataTypes::VecDeriv VecDeriv;
+        typedef typename DataTypes::Real Real;
 
-        helper::WriteAccessor< Data<VecCoord> > vDest = *this->write(core::VecCoordId(dest));
-        const unsigned int coordDim = DataTypeInfo<Coord>::size();
-        const unsigned int nbEntries = src->size()/coordDim;
 
-        for (unsigned int i=0; i<nbEntries; i++)
+        if (dest.type == sofa::core::V_COORD)
         {
-            for (unsigned int j=0; j<3; ++j)
-            {
-                Real tmp;
-                DataTypeInfo<Coord>::getValue(vDest[i+offset],j,tmp);
-                DataTypeInfo<Coord>::setValue(vDest[i+offset],j, tmp + src->element(i*coordDim+j));
-            }
 
-            helper::Quater<double> q_src;
-            helper::Quater<double> q_dest;
-            for (unsigned int j=0; j<4; j++)
+            helper::WriteAccessor< Data<VecCoord> > vDest = *mo.write(core::VecCoordId(dest));
+            const unsigned int coordDim = DataTypeInfo<Coord>::size();
+            const unsigned int nbEntries = src->size()/coordDim;
+            const bool normalize = mo.d_normalizeOrientations.getValue();
+
+            if constexpr (hasScalarLayout<Coord, Real>())
             {
-                Real tmp;
-                DataTypeInfo<Coord>::getValue(vDest[i+offset],j+3,tmp);
-                q_dest[j]=tmp;
-                q_src[j]=src->element(i * coordDim + j+3);
+                if (const Real* ps = contiguousData<Real>(src, nbEntries * coordDim))
+                {
+                    Real* pv = flatData(vDest.wref()) + offset * RigidSize;
+                    mo.parallelForDofs(nbEntries, [&](std::size_t begin, std::size_t end)
+                    {
+                        kernels::rigidAdd(pv + begin * RigidSize, ps + begin * RigidSize, end - begin, normalize);
+                    });
+                    offset += nbEntries;
+                    return;
+                }
             }
-            //q_dest = q_dest*q_src;
-            q_dest = q_src*q_dest;
-            for (unsigned int j=0; j<4; j++)
+
+            for (unsigned int i=0; i<nbEntries; i++)
             {
-                Real tmp=q_dest[j];
-                DataTypeInfo<Coord>::setValue(vDest[i+offset], j+3, tmp);
+                for (unsigned int j=0; j<3; ++j)
+                {
+                    Real tmp;
+                    DataTypeInfo<Coord>::getValue(vDest[i+offset],j,tmp);
+                    DataTypeInfo<Coord>::setValue(vDest[i+offset],j, tmp + src->element(i*coordDim+j));
+                }
+
+                helper::Quater<double> q_src;
+                helper::Quater<double> q_dest;
+                for (unsigned int j=0; j<4; j++)
+                {
+                    Real tmp;
+                    DataTypeInfo<Coord>::getValue(vDest[i+offset],j+3,tmp);
+                    q_dest[j]=tmp;
+                    q_src[j]=src->element(i * coordDim + j+3);
+                }
+                //q_dest = q_dest*q_src;
+                q_dest = q_src*q_dest;
+                if (normalize)
+                    q_dest.normalize();
+                for (unsigned int j=0; j<4; j++)
+                {
+                    Real tmp=q_dest[j];
+                    DataTypeInfo<Coord>::setValue(vDest[i+offset], j+3, tmp);
+                }
             }
+            offset += nbEntries;
         }
-        offset += nbEntries;
-    }
-    else
-    {
-        helper::WriteAccessor< Data<VecDeriv> > vDest = *this->write(core::VecDerivId(dest));
-
-        const unsigned int derivDim = DataTypeInfo<Deriv>::size();
-        const unsigned int nbEntries = src->size()/derivDim;
-        for (unsigned int i=0; i<nbEntries; i++)
+        else
         {
-            for (unsigned int j=0; j<derivDim; ++j)
+            helper::WriteAccessor< Data<VecDeriv> > vDest = *mo.write(core::VecDerivId(dest));
+
+            const unsigned int derivDim = DataTypeInfo<Deriv>::size();
+            const unsigned int nbEntries = src->size()/derivDim;
+            for (unsigned int i=0; i<nbEntries; i++)
             {
-                Real tmp;
-                DataTypeInfo<Deriv>::getValue(vDest[i+offset],j,tmp);
-                DataTypeInfo<Deriv>::setValue(vDest[i+offset],j, tmp + src->element(i*derivDim+j));
+                for (unsigned int j=0; j<derivDim; ++j)
+                {
+                    Real tmp;
+                    DataTypeInfo<Deriv>::getValue(vDest[i+offset],j,tmp);
+                    DataTypeInfo<Deriv>::setValue(vDest[i+offset],j, tmp + src->element(i*derivDim+j));
+                }
             }
+            offset += nbEntries;
         }
-        offset += nbEntries;
-    }
 
 
-}
+    }
 
-template<>
-void MechanicalObject<defaulttype::Rigid3Types>::addFromBaseVectorSameSize(core::VecId dest, const defaulttype::BaseVector* src, unsigned int &offset)
-{
-    if (dest.type == sofa::core::V_COORD)
+    static void addFromBaseVectorSameSize(MechanicalObject<DataTypes>& mo, core::VecId dest, const defaulttype::BaseVector* src, unsigned int &offset)
     {
-        helper::WriteAccessor< Data<VecCoord> > vDest = *this->write(core::VecCoordId(dest));
-        const unsigned int coordDim = DataTypeInfo<Coord>::size();
+        typedef typename DataTypes::Coord Coord;
+        typedef typename DataTypes::Deriv Deriv;
+        typedef typename DataTypes::VecCoord VecCoord;
+        typedef typename DataTypes::VecDeriv VecDeriv;
+        typedef typename DataTypes::Real Real;
 
-        for (unsigned int i=0; i<vDest.size(); i++)
+        if (dest.type == sofa::core::V_COORD)
         {
-            for (unsigned int j=0; j<3; j++)
+            helper::WriteAccessor< Data<VecCoord> > vDest = *mo.write(core::VecCoordId(dest));
+            const unsigned int coordDim = DataTypeInfo<Coord>::size();
+            const bool normalize = mo.d_normalizeOrientations.getValue();
+
+            if constexpr (hasScalarLayout<Coord, Real>())
             {
-                Real tmp;
-                DataTypeInfo<Coord>::getValue(vDest[i],j,tmp);
-                DataTypeInfo<Coord>::setValue(vDest[i],j,tmp + src->element(offset + i * coordDim + j));
+                if (const Real* ps = contiguousData<Real>(src, offset + vDest.size() * coordDim))
+                {
+                    Real* pv = flatData(vDest.wref());
+                    ps += offset;
+                    mo.parallelForDofs(vDest.size(), [&](std::size_t begin, std::size_t end)
+                    {
+                        kernels::rigidAdd(pv + begin * RigidSize, ps + begin * RigidSize, end - begin, normalize);
+                    });
+                    offset += vDest.size() * coordDim;
+                    return;
+                }
             }
 
-            helper::Quater<double> q_src;
-            helper::Quater<double> q_dest;
-            for (unsigned int j=0; j<4; j++)
+            for (unsigned int i=0; i<vDest.size(); i++)
             {
-                Real tmp;
-                DataTypeInfo<Coord>::getValue(vDest[i],j+3,tmp);
-                q_dest[j]=tmp;
-                q_src[j]=src->element(offset + i * coordDim + j+3);
+                for (unsigned int j=0; j<3; j++)
+                {
+                    Real tmp;
+                    DataTypeInfo<Coord>::getValue(vDest[i],j,tmp);
+                    DataTypeInfo<Coord>::setValue(vDest[i],j,tmp + src->element(offset + i * coordDim + j));
+                }
+
+                helper::Quater<double> q_src;
+                helper::Quater<double> q_dest;
+                for (unsigned int j=0; j<4; j++)
+                {
+                    Real tmp;
+                    DataTypeInfo<Coord>::getValue(vDest[i],j+3,tmp);
+                    q_dest[j]=tmp;
+                    q_src[j]=src->element(offset + i * coordDim + j+3);
+                }
+                //q_dest = q_dest*q_src;
+                q_dest = q_src*q_dest;
+                if (normalize)
+                    q_dest.normalize();
+                for (unsigned int j=0; j<4; j++)
+                {
+                    Real tmp=q_dest[j];
+                    DataTypeInfo<Coord>::setValue(vDest[i], j+3, tmp);
+                }
             }
-            //q_dest = q_dest*q_src;
-            q_dest = q_src*q_dest;
-            for (unsigned int j=0; j<4; j++)
+
+            offset += vDest.size() * coordDim;
+        }
+        else
+        {
+            helper::WriteAccessor< Data<VecDeriv> > vDest = *mo.write(core::VecDerivId(dest));
+            const unsigned int derivDim = DataTypeInfo<Deriv>::size();
+            for (unsigned int i=0; i<vDest.size(); i++)
             {
-                Real tmp=q_dest[j];
-                DataTypeInfo<Coord>::setValue(vDest[i], j+3, tmp);
+                for (unsigned int j=0; j<derivDim; j++)
+                {
+                    Real tmp;
+                    DataTypeInfo<Deriv>::getValue(vDest[i],j,tmp);
+                    DataTypeInfo<Deriv>::setValue(vDest[i], j, tmp + src->element(offset + i * derivDim + j));
+                }
             }
+            offset += vDest.size() * derivDim;
         }
 
-        offset += vDest.size() * coordDim;
     }
-    else
+
+
+    static void draw(MechanicalObject<DataTypes>& mo, const core::visual::VisualParams* vparams)
     {
-        helper::WriteAccessor< Data<VecDeriv> > vDest = *this->write(core::VecDerivId(dest));
-        const unsigned int derivDim = DataTypeInfo<Deriv>::size();
-        for (unsigned int i=0; i<vDest.size(); i++)
+        typedef typename DataTypes::VecCoord VecCoord;
+
+        vparams->drawTool()->saveLastState();
+        vparams->drawTool()->setLightingEnabled(false);
+
+        if (mo.showIndices.getValue())
         {
-            for (unsigned int j=0; j<derivDim; j++)
+            mo.drawIndices(vparams);
+        }
+
+        if (mo.showVectors.getValue())
+        {
+            mo.drawVectors(vparams);
+        }
+
+        if (mo.showObject.getValue())
+        {
+            const float scale = mo.showObjectScale.getValue();
+            helper::ReadAccessor<Data<VecCoord> > x = *mo.read(core::VecCoordId::position());
+            const size_t vsize = mo.d_size.getValue();
+            for (size_t i = 0; i < vsize; ++i)
             {
-                Real tmp;
-                DataTypeInfo<Deriv>::getValue(vDest[i],j,tmp);
-                DataTypeInfo<Deriv>::setValue(vDest[i], j, tmp + src->element(offset + i * derivDim + j));
+                vparams->drawTool()->pushMatrix();
+                float glTransform[16];
+                ///TODO: check if the drawtool use OpenGL-shaped matrix
+                x[i].writeOpenGlMatrix ( glTransform );
+                vparams->drawTool()->multMatrix( glTransform );
+                vparams->drawTool()->scale ( scale );
+
+                if (mo.getContext()->isSleeping())
+                {
+                    vparams->drawTool()->drawFrame ( Vector3(), Quat(), Vector3 ( 1,1,1 ), Vec4f(0.5,0.5,0.5,1) );
+                }
+                else switch( mo.drawMode.getValue() )
+                {
+                    case 1:
+                        vparams->drawTool()->drawFrame ( Vector3(), Quat(), Vector3 ( 1,1,1 ), Vec4f(0,1,0,1) );
+                        break;
+                    case 2:
+                        vparams->drawTool()->drawFrame ( Vector3(), Quat(), Vector3 ( 1,1,1 ), Vec4f(1,0,0,1) );
+                        break;
+                    case 3:
+                        vparams->drawTool()->drawFrame ( Vector3(), Quat(), Vector3 ( 1,1,1 ), Vec4f(0,0,1,1) );
+                        break;
+                    case 4:
+                        vparams->drawTool()->drawFrame ( Vector3(), Quat(), Vector3 ( 1,1,1 ), Vec4f(1,1,0,1) );
+                        break;
+                    case 5:
+                        vparams->drawTool()->drawFrame ( Vector3(), Quat(), Vector3 ( 1,1,1 ), Vec4f(1,0,1,1) );
+                        break;
+                    case 6:
+                        vparams->drawTool()->drawFrame ( Vector3(), Quat(), Vector3 ( 1,1,1 ), Vec4f(0,1,1,1) );
+                        break;
+                    default:
+                        vparams->drawTool()->drawFrame ( Vector3(), Quat(), Vector3 ( 1,1,1 ) );
+                }
+
+                vparams->drawTool()->popMatrix();
             }
         }
-        offset += vDest.size() * derivDim;
+        vparams->drawTool()->restoreLastState();
     }
+};
 
+
+template<>
+void MechanicalObject<defaulttype::Rigid3Types>::applyRotation (const defaulttype::Quat q)
+{
+    Rigid3Impl::applyRotation(*this, q);
+    markDirty(core::ConstVecCoordId::position());
 }
 
+template<>
+void MechanicalObject<defaulttype::Rigid3fTypes>::applyRotation (const defaulttype::Quat q)
+{
+    Rigid3Impl::applyRotation(*this, q);
+    markDirty(core::ConstVecCoordId::position());
+}
 
 template<>
-void MechanicalObject<defaulttype::Rigid3Types>::draw(const core::visual::VisualParams* vparams)
+void MechanicalObject<defaulttype::Rigid3Types>::addFromBaseVectorDifferentSize(core::VecId dest, const defaulttype::BaseVector* src, unsigned int &offset )
 {
-    vparams->drawTool()->saveLastState();
-    vparams->drawTool()->setLightingEnabled(false);
+    NODEPHYSICS_PROBE(m_probes, ProbeAddFromBaseVector, 2 * src->size() * sizeof(Real));
+    const unsigned int first = offset;
+    Rigid3Impl::addFromBaseVectorDifferentSize(*this, dest, src, offset);
+    markDirty(dest, first, offset);
+}
 
-	if (showIndices.getValue())
-	{
-        drawIndices(vparams);
-	}
+template<>
+void MechanicalObject<defaulttype::Rigid3fTypes>::addFromBaseVectorDifferentSize(core::VecId dest, const defaulttype::BaseVector* src, unsigned int &offset )
+{
+    NODEPHYSICS_PROBE(m_probes, ProbeAddFromBaseVector, 2 * src->size() * sizeof(Real));
+    const unsigned int first = offset;
+    Rigid3Impl::addFromBaseVectorDifferentSize(*this, dest, src, offset);
+    markDirty(dest, first, offset);
+}
 
-    if (showVectors.getValue())
-    {
-        drawVectors(vparams);
-    }
+template<>
+void MechanicalObject<defaulttype::Rigid3Types>::addFromBaseVectorSameSize(core::VecId dest, const defaulttype::BaseVector* src, unsigned int &offset)
+{
+    NODEPHYSICS_PROBE(m_probes, ProbeAddFromBaseVector, 2 * getProbeBytes(dest));
+    Rigid3Impl::addFromBaseVectorSameSize(*this, dest, src, offset);
+    markDirty(dest);
+}
 
-    if (showObject.getValue())
-    {
-        const float scale = showObjectScale.getValue();
-        helper::ReadAccessor<Data<VecCoord> > x = *this->read(core::VecCoordId::position());
-        const size_t vsize = d_size.getValue();
-        for (size_t i = 0; i < vsize; ++i)
-        {
-            vparams->drawTool()->pushMatrix();
-            float glTransform[16];
-            ///TODO: check if the drawtool use OpenGL-shaped matrix
-            x[i].writeOpenGlMatrix ( glTransform );
-            vparams->drawTool()->multMatrix( glTransform );
-            vparams->drawTool()->scale ( scale );
-
-			if (getContext()->isSleeping())
-			{
-				vparams->drawTool()->drawFrame ( Vector3(), Quat(), Vector3 ( 1,1,1 ), Vec4f(0.5,0.5,0.5,1) );
-			}
-			else switch( drawMode.getValue() )
-            {
-                case 1:
-                    vparams->drawTool()->drawFrame ( Vector3(), Quat(), Vector3 ( 1,1,1 ), Vec4f(0,1,0,1) );
-                    break;
-                case 2:
-                    vparams->drawTool()->drawFrame ( Vector3(), Quat(), Vector3 ( 1,1,1 ), Vec4f(1,0,0,1) );
-                    break;
-                case 3:
-                    vparams->drawTool()->drawFrame ( Vector3(), Quat(), Vector3 ( 1,1,1 ), Vec4f(0,0,1,1) );
-                    break;
-                case 4:
-                    vparams->drawTool()->drawFrame ( Vector3(), Quat(), Vector3 ( 1,1,1 ), Vec4f(1,1,0,1) );
-                    break;
-                case 5:
-                    vparams->drawTool()->drawFrame ( Vector3(), Quat(), Vector3 ( 1,1,1 ), Vec4f(1,0,1,1) );
-                    break;
-                case 6:
-                    vparams->drawTool()->drawFrame ( Vector3(), Quat(), Vector3 ( 1,1,1 ), Vec4f(0,1,1,1) );
-                    break;
-                default:
-                    vparams->drawTool()->drawFrame ( Vector3(), Quat(), Vector3 ( 1,1,1 ) );
-            }
+template<>
+void MechanicalObject<defaulttype::Rigid3fTypes>::addFromBaseVectorSameSize(core::VecId dest, const defaulttype::BaseVector* src, unsigned int &offset)
+{
+    NODEPHYSICS_PROBE(m_probes, ProbeAddFromBaseVector, 2 * getProbeBytes(dest));
+    Rigid3Impl::addFromBaseVectorSameSize(*this, dest, src, offset);
+    markDirty(dest);
+}
 
-            vparams->drawTool()->popMatrix();
-        }
-    }
-    vparams->drawTool()->restoreLastState();
+template<>
+void MechanicalObject<defaulttype::Rigid3Types>::draw(const core::visual::VisualParams* vparams)
+{
+    Rigid3Impl::draw(*this, vparams);
+}
+
+template<>
+void MechanicalObject<defaulttype::Rigid3fTypes>::draw(const core::visual::VisualParams* vparams)
+{
+    Rigid3Impl::draw(*this, vparams);
 }
 
 } // namespace sofa
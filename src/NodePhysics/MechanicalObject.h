@@ -23,6 +23,7 @@
 
 #include <vector>
 #include <fstream>
+#include <type_traits>
 
 #include <sofa/core/behavior/MechanicalState.h>
 #include <sofa/core/topology/BaseMeshTopology.h>
@@ -35,6 +36,11 @@
 
 #include <NodePhysics/config.h>
 #include <NodePhysics/ObjectLink.h>
+#include <NodePhysics/DirtyRanges.h>
+#include <NodePhysics/SpatialGrid.h>
+#include <NodePhysics/Instrumentation.h>
+
+#include <map>
 
 
 namespace nodephysics
@@ -84,6 +90,11 @@ public:
 
     typedef sofa::defaulttype::Vector3 Vector3;
 
+    /// True when Coord and Deriv are the same plain array of Real (Vec types),
+    /// so that state vectors can be processed as flat arrays of scalars.
+    static constexpr bool FlatLayout = std::is_same<Coord, Deriv>::value
+            && sizeof(Deriv) == Deriv::total_size * sizeof(Real);
+
 protected:
     MechanicalObject();
 public:
@@ -113,6 +124,23 @@ public:
     Data< SReal > restScale; ///< optional scaling of rest position coordinates (to simulated pre-existing internal tension).(default = 1.0)
 
     Data< bool >  d_useTopology; ///< Shall this object rely on any active topology to initialize its size and positions
+    Data< bool >  d_deterministicReductions; ///< Compute vDot/vSum with fixed chunking and compensated sums, so that results do not depend on the number of threads. If false, they are summed in order, or in one part per thread when run in parallel. (default=false)
+    Data< int >   d_parallelGrainSize; ///< Minimum number of DOFs per task in parallel per-DOF loops. 0 disables parallelism. (default=0)
+    Data< bool >  d_vectorPool; ///< Keep the buffers of freed temporary vectors, to reuse them in vAlloc. (default=true)
+    Data< bool >  d_vAllocNoInit; ///< Do not reset the values of the buffers reused by vAlloc, for solvers overwriting the allocated vectors anyway. (default=false)
+    Data< unsigned int >  d_vectorPoolHits; ///< Number of vAlloc calls served from the pool of freed buffers
+    Data< unsigned long > d_vectorPoolBytes; ///< Memory currently retained by the pool of freed buffers, in bytes
+    Data< SReal > d_compareTolerance; ///< Maximal absolute difference accepted by compareVec, larger ones are reported. 0 disables the check. (default=0)
+    Data< bool >  d_trackDirtyRanges; ///< Record the index ranges modified in the state vectors, see markDirty and getDirtyRanges. (default=false)
+    Data< bool >  d_spatialIndex; ///< Accelerate getIndicesInSpace, pickParticles and getNearestParticles with a uniform grid over the positions, rebuilt when they change. (default=false)
+    Data< bool >  d_normalizeOrientations; ///< Rigid3 only: scale the orientation quaternions back to unit length after each position update. (default=false)
+    Data< bool >  d_sparseForces; ///< Reset the force only on the DOFs given to insertForceMaskEntry during this step and the previous one, and accumulate only the external forces given to addExternalForce. Requires the components writing forces to declare their DOFs with insertForceMaskEntry. (default=false)
+
+    Data< helper::vector<std::string> > d_probeNames; ///< Instrumented functions, built with NODEPHYSICS_INSTRUMENTATION
+    Data< helper::vector<unsigned long> > d_probeCalls; ///< Number of calls of each instrumented function, updated at the end of each step
+    Data< helper::vector<unsigned long> > d_probeCycles; ///< Cycles (time stamp counter) spent in each instrumented function, updated at the end of each step
+    Data< helper::vector<unsigned long> > d_probeBytes; ///< Estimated bytes of state read and written by each instrumented function, updated at the end of each step
+    Data< std::string > d_probeFile; ///< File the statistics of the instrumented functions are appended to in JSON at cleanup. Empty for none.
 
     Data< bool >  showObject; ///< Show objects. (default=false)
     Data< float > showObjectScale; ///< Scale for object display. (default=0.1)
@@ -130,12 +158,38 @@ public:
 
     void reset() override;
 
+    void cleanup() override;
+    void handleEvent(sofa::core::objectmodel::Event* event) override;
+
     void writeVec(core::ConstVecId v, std::ostream &out) override;
     void readVec(core::VecId v, std::istream &in) override;
     SReal compareVec(core::ConstVecId v, std::istream &in) override;
 
+    /// Differences between a vector and reference values, overall and for each scalar component of Coord/Deriv.
+    struct VecComparison
+    {
+        unsigned int nbValues {0}; ///< number of compared scalar values
+        SReal meanAbsError {0};
+        SReal maxAbsError {0};
+        SReal l2Error {0}; ///< square root of the sum of the squared differences
+        helper::vector<SReal> meanAbsErrors; ///< for each component
+        helper::vector<SReal> maxAbsErrors; ///< for each component
+        helper::vector<SReal> l2Errors; ///< for each component
+        bool withinTolerance {true}; ///< false if maxAbsError is above compareTolerance
+    };
+
+    /// Compare a vector with nbRef reference scalar values, given in the order of DataTypeInfo.
+    /// Only the first min(nbRef, number of scalars of v) values are compared.
+    VecComparison compareVecValues(core::ConstVecId v, const SReal* ref, std::size_t nbRef);
+
     void writeState( std::ostream& out ) override;
 
+    /// Write d_size and all the allocated vectors and matrices in a binary checkpoint file.
+    bool writeCheckpoint(const std::string& filename);
+
+    /// Restore a checkpoint written by writeCheckpoint for the same template. The file is memory-mapped when possible.
+    bool readCheckpoint(const std::string& filename);
+
     /// @name New vectors access API based on VecId
     /// @{
 
@@ -163,6 +217,13 @@ public:
     SReal getVY(size_t i) const { Real x=0.0,y=0.0,z=0.0; DataTypes::get(x,y,z, read(core::ConstVecDerivId::velocity())->getValue()[i]); return (SReal)y; }
     SReal getVZ(size_t i) const { Real x=0.0,y=0.0,z=0.0; DataTypes::get(x,y,z, read(core::ConstVecDerivId::velocity())->getValue()[i]); return (SReal)z; }
 
+    /// Bulk version of getPX/getPY/getPZ: write the x,y,z coordinates of the positions of the
+    /// getSize() DOFs in positions, the ones of DOF i at positions[i*stride] (stride >= 3).
+    /// If velocities is not null, the velocities are written the same way, zero past the end
+    /// of the velocity vector. Returns the number of DOFs written.
+    size_t exportPositions(double* positions, size_t stride = 3, double* velocities = nullptr) const;
+    size_t exportPositions(float* positions, size_t stride = 3, float* velocities = nullptr) const;
+
     std::string getClassName() const override
     {
         return "NodePhysics.MechanicalObject";
@@ -190,10 +251,20 @@ public:
      */
     void swapValues (const int idx1, const int idx2);
 
+    /** \brief Remove the values at the given indices, the last values being moved in their place.
+     *
+     * Same result as calling replaceValue(last--, indices[i]) for each index and resizing,
+     * but the moves are computed once and applied to each vector in a single edit.
+     */
+    void removeValues( const sofa::helper::vector<unsigned int>& indices );
+
     /** \brief Reorder values according to parameter.
      *
      * Result of this method is :
      * newValue[ i ] = oldValue[ index[i] ];
+     *
+     * When index is a permutation, the vectors are permuted in place by following its cycles,
+     * all vectors concurrently, without temporary copies.
      */
     void renumberValues( const sofa::helper::vector<unsigned int> &index );
 
@@ -203,6 +274,15 @@ public:
      */
     void computeWeightedValue( const unsigned int i, const sofa::helper::vector< unsigned int >& ancestors, const sofa::helper::vector< double >& coefs);
 
+    /** \brief Replace the values at indices[p] by the sums of their ancestors values weighted by the coefs, for all p.
+     *
+     * The ancestors of indices[p] are given in CSR layout: ancestors[k] and coefs[k] for k in [offsets[p],offsets[p+1]).
+     * Same result as calling computeWeightedValue for each index in order. The values are computed in
+     * parallel, unless one of them is an ancestor of another one.
+     */
+    void computeWeightedValues( const sofa::helper::vector< unsigned int >& indices, const sofa::helper::vector< unsigned int >& offsets,
+                                const sofa::helper::vector< unsigned int >& ancestors, const sofa::helper::vector< double >& coefs);
+
     /// Force the position of a point (and force its velocity to zero value)
     void forcePointPosition( const unsigned int i, const sofa::helper::vector< double >& m_x);
 
@@ -224,6 +304,9 @@ public:
     /// Get the indices of the particles located in the given bounding box
     void getIndicesInSpace(sofa::helper::vector<unsigned>& indices, Real xmin, Real xmax, Real ymin, Real ymax, Real zmin, Real zmax) const override;
 
+    /// Get the indices of the k particles closest to p, from the closest to the farthest
+    void getNearestParticles(const defaulttype::Vector3& p, unsigned int k, sofa::helper::vector<unsigned>& indices) const;
+
     /// update the given bounding box, to include this
     bool addBBox(SReal* minBBox, SReal* maxBBox) override;
     /// Bounding Box computation method.
@@ -259,8 +342,46 @@ public:
 
     /// Express the matrix L in term of block of matrices, using the indices of the lines in the MatrixDeriv container
     virtual std::list<ConstraintBlock> constraintBlocks( const std::list<unsigned int> &indices) const override;
+
+    /// Blocks of constraint lines, one for each column (DOF) they touch, all stored in the same arrays.
+    /// The non-zero lines of block b are entries [blockBegin[b],blockBegin[b+1]): entry e is the line
+    /// lines[e] (position in the requested indices), with the blockSize values at values[e * blockSize].
+    /// Reusing the same object between steps keeps its memory, call release() to free it.
+    struct ConstraintBlocks
+    {
+        unsigned int nbLines {0};
+        unsigned int blockSize {0};
+        helper::vector<unsigned int> columns; ///< column of each block, in increasing order
+        helper::vector<unsigned int> blockBegin;
+        helper::vector<unsigned int> lines;
+        helper::vector<SReal> values;
+
+        struct Entry
+        {
+            unsigned int column;
+            unsigned int line;
+            const Deriv* value;
+            bool operator<(const Entry& e) const { return column < e.column || (column == e.column && line < e.line); }
+        };
+        helper::vector<Entry> entries; ///< used while building
+
+        void clear() { nbLines = 0; columns.clear(); blockBegin.clear(); lines.clear(); values.clear(); entries.clear(); }
+        void release() { clear(); helper::vector<unsigned int>().swap(columns); helper::vector<unsigned int>().swap(blockBegin);
+                         helper::vector<unsigned int>().swap(lines); helper::vector<SReal>().swap(values);
+                         helper::vector<Entry>().swap(entries); }
+    };
+
+    /// Same blocks as constraintBlocks, without allocating one matrix per block.
+    void getConstraintBlocks( const helper::vector<unsigned int>& indices, ConstraintBlocks& blocks ) const;
     SReal getConstraintJacobianTimesVecDeriv( unsigned int line, core::ConstVecId id) override;
 
+    /// J*w for all the constraint lines: lines receives their indices, in increasing order, and result the values.
+    /// Both are empty if w does not exist or if J refers to DOFs outside of w.
+    void getConstraintJacobianTimesVecDeriv( core::ConstVecDerivId w, helper::vector<unsigned int>& lines, helper::vector<SReal>& result);
+    /// J*w for the given constraint lines, 0 for the lines which do not exist.
+    /// All values are 0 if w does not exist or if J refers to DOFs outside of w.
+    void getConstraintJacobianTimesVecDeriv( const helper::vector<unsigned int>& lines, core::ConstVecDerivId w, helper::vector<SReal>& result);
+
     /// @name Initial transformations accessors.
     /// @{
 
@@ -283,6 +404,35 @@ public:
 
     void accumulateForce(const core::ExecParams* params, core::VecDerivId f = core::VecDerivId::force()) override; // see BaseMechanicalState::accumulateForce(const ExecParams*, VecId) override
 
+    /// Add a force to the external force of a DOF.
+    /// The DOFs given here are recorded, so that in sparse mode accumulateForce does not scan the whole external force vector.
+    void addExternalForce(unsigned int index, const Deriv& force);
+
+    /// Insert a DOF in the force mask.
+    /// The DOFs given here are recorded, so that in sparse mode resetForce only zeroes them, without scanning the mask.
+    void insertForceMaskEntry(unsigned int index);
+
+    /// @}
+
+    /// @name Dirty ranges
+    /// When trackDirtyRanges is set, the writers of this class (vOp, vMultiOp, apply*, the BaseVector bridges,
+    /// the topological changes) record the modified DOFs with markDirty. Consumers query the DOFs modified
+    /// since their last call to clearDirtyRanges. A modification of the
+    /// vector not recorded with markDirty (detected through the Data counter) marks the whole vector as dirty.
+    /// @{
+
+    /// Record that the DOFs [begin,end) of v were modified by the last edit of v. To be called once after each edit.
+    void markDirty(core::ConstVecId v, std::size_t begin, std::size_t end);
+
+    /// Record that the whole vector v was modified by the last edit of v.
+    void markDirty(core::ConstVecId v);
+
+    /// DOFs of v modified since the last call to clearDirtyRanges(v). The whole vector if tracking is disabled.
+    const DirtyRanges& getDirtyRanges(core::ConstVecId v);
+
+    /// Acknowledge the modifications of v.
+    void clearDirtyRanges(core::ConstVecId v);
+
     /// Increment the index of the given VecCoordId, so that all 'allocated' vectors in this state have a lower index
     void vAvail(const core::ExecParams* params, core::VecCoordId& v) override;
     /// Increment the index of the given VecDerivId, so that all 'allocated' vectors in this state have a lower index
@@ -341,6 +491,22 @@ public:
 
     void getConstraintJacobian(const core::ConstraintParams* cparams, sofa::defaulttype::BaseMatrix* J,unsigned int & off) override;
 
+    /// Constraint Jacobian rows in CSR layout: row r is the constraint rowIndices[r], with the values
+    /// values[k] at the scalar columns colIndices[k] for k in [rowBegin[r],rowBegin[r+1]), columns in increasing order.
+    struct ConstraintJacobianCSR
+    {
+        helper::vector<int> rowIndices;
+        helper::vector<int> rowBegin;
+        helper::vector<int> colIndices;
+        helper::vector<SReal> values;
+
+        void clear() { rowIndices.clear(); rowBegin.clear(); colIndices.clear(); values.clear(); }
+    };
+
+    /// Export the constraint Jacobian in CSR layout, the columns being shifted by off, for matrix
+    /// backends able to ingest whole rows. Same entries as getConstraintJacobian adds to its matrix.
+    void getConstraintJacobian(const core::ConstraintParams* cparams, ConstraintJacobianCSR& J, unsigned int off) const;
+
     void buildIdentityBlocksInJacobian(const sofa::helper::vector<unsigned int>& list_n, core::MatrixDerivId &mID) override;
     /// @}
 
@@ -374,6 +540,9 @@ public:
    }
 protected :
 
+    /// Implementations of the Rigid3 specializations, in MechanicalObject.cpp.
+    struct Rigid3Impl;
+
     /// @name Initial geometric transformations
     /// @{
 
@@ -418,6 +587,189 @@ protected :
     void setVecMatrixDeriv(unsigned int /*index*/, Data< MatrixDeriv> * /*mDeriv*/);
 
 
+    /// @}
+
+    /// @name Pool of temporary vectors
+    /// @{
+
+    helper::vector<VecCoord> m_coordPool; ///< buffers of freed dynamic VecCoord, with their size and values
+    helper::vector<VecDeriv> m_derivPool; ///< buffers of freed dynamic VecDeriv, with their size and values
+
+    /// Maximal number of buffers kept in each pool, the following freed vectors keep their own.
+    static constexpr std::size_t MaxPoolSize = 16;
+
+    /// Give the data a buffer from the pool, if any, resized to the size of the state.
+    /// Returns false, leaving the data untouched, if it already has a buffer.
+    template<class VecType>
+    bool allocFromPool(const core::ExecParams* params, Data<VecType>& d, helper::vector<VecType>& pool);
+
+    /// Move the buffer of the data to the pool, leaving the data empty.
+    template<class VecType>
+    void releaseToPool(const core::ExecParams* params, Data<VecType>& d, helper::vector<VecType>& pool);
+
+    void updateVectorPoolBytes();
+
+    /// @}
+
+    /// @name Sparse forces
+    /// @{
+
+    helper::vector<unsigned int> m_externalForceDofs; ///< DOFs given to addExternalForce since the external forces were cleared
+    helper::vector<bool> m_isExternalForceDof;
+    int m_externalForceCounter {-1}; ///< counter of the external forces after the last addExternalForce, to detect other writes
+    helper::vector<unsigned int> m_forceDofs; ///< DOFs given to insertForceMaskEntry during this step
+    helper::vector<bool> m_isForceDof;
+    helper::vector<unsigned int> m_previousForceDofs; ///< DOFs of m_forceDofs at the end of the last step, possibly holding non-zero forces
+    bool m_forceDofsValid {false}; ///< false if any DOF out of the lists may hold a non-zero force
+
+    /// Empty the list of external forces given to addExternalForce.
+    void clearExternalForceDofs();
+
+    /// @}
+
+    /// @name Dirty ranges
+    /// @{
+
+    struct DirtyTracker
+    {
+        DirtyRanges ranges;
+        int counter {-1}; ///< counter of the vector when the ranges were last updated
+    };
+
+    std::map< std::pair<int, unsigned int>, DirtyTracker > m_dirtyTrackers; ///< indexed by vector type and index
+
+    DirtyTracker& getDirtyTracker(core::ConstVecId v) { return m_dirtyTrackers[std::make_pair((int)v.type, v.index)]; }
+
+    /// Counter and size of the Data holding v.
+    void getVecState(core::ConstVecId v, int& counter, std::size_t& size);
+
+    /// @}
+
+    /// @name Spatial index of the positions
+    /// @{
+
+    /// Grid over the current positions, rebuilt if they changed, or nullptr if spatialIndex is not set.
+    const SpatialGrid* getSpatialGrid() const;
+
+    mutable SpatialGrid m_spatialGrid;
+    mutable int m_spatialGridCounter {-1}; ///< counter of the positions when the grid was built
+
+    /// @}
+
+    /// @name Cached bounding box of the positions
+    /// @{
+
+    /// Bounding box of the (DataTypes::get) positions, recomputed only if they changed.
+    /// Returns false if there is no position.
+    bool getPositionsBBox(Real minBBox[3], Real maxBBox[3]) const;
+
+    mutable Real m_bboxMin[3] {0, 0, 0};
+    mutable Real m_bboxMax[3] {0, 0, 0};
+    mutable int m_bboxCounter {-1}; ///< counter of the positions when the bounding box was computed
+    mutable std::size_t m_bboxSize {0};
+
+    /// @}
+
+    /// @name Draw buffers, kept between frames
+    /// @{
+
+    /// Export the positions, and the velocities if requested, in m_drawPositions and
+    /// m_drawVelocities, unless they did not change since the previous call.
+    /// m_drawVelocities is left untouched when the velocities are not requested.
+    void updateDrawBuffers(bool withVelocities);
+
+    helper::vector<Vector3> m_drawPositions;
+    helper::vector<Vector3> m_drawVelocities;
+    helper::vector<Vector3> m_drawVectorLines; ///< end points of the drawn velocities, two per DOF
+    int m_drawPositionsCounter {-1}; ///< counter of the positions when m_drawPositions was exported
+    int m_drawVelocitiesCounter {-1}; ///< counter of the velocities when m_drawVelocities was exported
+    float m_drawVectorLinesScale {0}; ///< scale of m_drawVectorLines
+    bool m_drawVectorLinesValid {false}; ///< false when m_drawVectorLines must be computed again
+
+    /// @}
+
+    /// Fill the values of one vector for computeWeightedValues.
+    template<class VecType>
+    void interpolateValues(VecType& vec, const sofa::helper::vector< unsigned int >& indices, const sofa::helper::vector< unsigned int >& offsets,
+                           const sofa::helper::vector< unsigned int >& ancestors, const sofa::helper::vector< double >& coefs, bool parallel) const;
+
+    template<class T>
+    size_t exportPositionsAs(T* positions, size_t stride, T* velocities) const;
+
+    /// If printed is set, the values of cur are first rounded as writeVec prints them.
+    template<class VecType>
+    VecComparison compareValues(const VecType& cur, const SReal* ref, std::size_t nbRef, bool printed) const;
+
+    /// Call f(begin,end) on sub-ranges of [0,n) DOFs, in parallel if n is above d_parallelGrainSize.
+    template<class F>
+    void parallelForDofs(std::size_t n, const F& f) const;
+
+    /// True if reductions over n DOFs run on the task pool: n is above d_parallelGrainSize.
+    bool parallelReductions(std::size_t n) const;
+
+    /// vOp on flat scalar arrays, using the SIMD kernels. Only used when FlatLayout is true.
+    /// Returns false if the operation is invalid, so that the generic implementation reports it.
+    template<class T = DataTypes>
+    bool vOpFlat(const core::ExecParams* params, core::VecId v, core::ConstVecId a, core::ConstVecId b, SReal f);
+
+    /// @name Fused vMultiOp evaluation
+    /// @{
+
+    /// Structure of a vMultiOp call, validated once for each pattern of vector ids.
+    struct VMultiOpPlan
+    {
+        struct Op
+        {
+            core::VecId dest;
+            helper::vector<core::ConstVecId> terms;
+        };
+        helper::vector<Op> ops;
+        bool fusable {false}; ///< false if the pattern must be evaluated one vOp at a time
+    };
+
+    std::map< helper::vector<unsigned int>, VMultiOpPlan > m_vMultiOpPlans; ///< plans, indexed by the types and indices of the vectors
+
+    /// Return the (cached) plan corresponding to the given operations.
+    const VMultiOpPlan& getVMultiOpPlan(const VMultiOp& ops);
+
+    /// Evaluate all operations in a single pass over blocks of scalars. Only used when FlatLayout is true.
+    template<class T = DataTypes>
+    void vMultiOpFlat(const core::ExecParams* params, const VMultiOpPlan& plan, const VMultiOp& ops);
+
+    /// Evaluate all operations in a single pass over the DOFs, using the Coord and Deriv operators.
+    void vMultiOpTyped(const core::ExecParams* params, const VMultiOpPlan& plan, const VMultiOp& ops);
+
+    /// @}
+
+    /// @name Instrumentation of the hot paths, see Instrumentation.h
+    /// @{
+
+    enum ProbeIndex
+    {
+        ProbeVOp,
+        ProbeVMultiOp,
+        ProbeVDot,
+        ProbeAccumulateForce,
+        ProbeResetForce,
+        ProbeCopyToBaseVector,
+        ProbeCopyFromBaseVector,
+        ProbeAddToBaseVector,
+        ProbeAddFromBaseVector,
+        ProbeHandleStateChange
+    };
+
+    instrumentation::ProbeSet m_probes { { "vOp", "vMultiOp", "vDot", "accumulateForce", "resetForce",
+                                           "copyToBaseVector", "copyFromBaseVector", "addToBaseVector", "addFromBaseVector",
+                                           "handleStateChange" } };
+
+    /// Size in bytes of the vector v, 0 for the matrices.
+    std::size_t getProbeBytes(core::ConstVecId v) const;
+    /// Size in bytes of all the vectors of the plan.
+    std::size_t getProbeBytes(const VMultiOpPlan& plan) const;
+
+    /// Copy the values of the probes into the probe Data.
+    void updateProbeData();
+
     /// @}
 
     /**
@@ -440,17 +792,29 @@ protected :
 template<> SOFA_BASE_MECHANICS_API
 void MechanicalObject<defaulttype::Rigid3Types>::applyRotation (const defaulttype::Quat q);
 
+template<> SOFA_BASE_MECHANICS_API
+void MechanicalObject<defaulttype::Rigid3fTypes>::applyRotation (const defaulttype::Quat q);
+
 template<> SOFA_BASE_MECHANICS_API
 void MechanicalObject<defaulttype::Rigid3Types>::addFromBaseVectorSameSize(core::VecId dest, const defaulttype::BaseVector* src, unsigned int &offset );
 
+template<> SOFA_BASE_MECHANICS_API
+void MechanicalObject<defaulttype::Rigid3fTypes>::addFromBaseVectorSameSize(core::VecId dest, const defaulttype::BaseVector* src, unsigned int &offset );
+
 
 template<> SOFA_BASE_MECHANICS_API
 void MechanicalObject<defaulttype::Rigid3Types>::addFromBaseVectorDifferentSize(core::VecId dest, const defaulttype::BaseVector* src, unsigned int &offset );
 
+template<> SOFA_BASE_MECHANICS_API
+void MechanicalObject<defaulttype::Rigid3fTypes>::addFromBaseVectorDifferentSize(core::VecId dest, const defaulttype::BaseVector* src, unsigned int &offset );
+
 
 template<> SOFA_BASE_MECHANICS_API
 void MechanicalObject<defaulttype::Rigid3Types>::draw(const core::visual::VisualParams* vparams);
 
+template<> SOFA_BASE_MECHANICS_API
+void MechanicalObject<defaulttype::Rigid3fTypes>::draw(const core::visual::VisualParams* vparams);
+
 
 
 
@@ -461,6 +825,12 @@ extern template class SOFA_BASE_MECHANICS_API MechanicalObject<defaulttype::Vec1
 extern template class SOFA_BASE_MECHANICS_API MechanicalObject<defaulttype::Vec6Types>;
 extern template class SOFA_BASE_MECHANICS_API MechanicalObject<defaulttype::Rigid3Types>;
 extern template class SOFA_BASE_MECHANICS_API MechanicalObject<defaulttype::Rigid2Types>;
+extern template class SOFA_BASE_MECHANICS_API MechanicalObject<defaulttype::Vec3fTypes>;
+extern template class SOFA_BASE_MECHANICS_API MechanicalObject<defaulttype::Vec2fTypes>;
+extern template class SOFA_BASE_MECHANICS_API MechanicalObject<defaulttype::Vec1fTypes>;
+extern template class SOFA_BASE_MECHANICS_API MechanicalObject<defaulttype::Vec6fTypes>;
+extern template class SOFA_BASE_MECHANICS_API MechanicalObject<defaulttype::Rigid3fTypes>;
+extern template class SOFA_BASE_MECHANICS_API MechanicalObject<defaulttype::Rigid2fTypes>;
 
 #endif
 
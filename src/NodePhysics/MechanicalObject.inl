@@ -22,8 +22,14 @@
 #pragma once
 
 #include <NodePhysics/MechanicalObject.h>
+#include <NodePhysics/VecKernels.h>
+#include <NodePhysics/Reduction.h>
+#include <NodePhysics/TaskPool.h>
+#include <NodePhysics/Checkpoint.h>
 #include <sofa/core/visual/VisualParams.h>
 #include <SofaBaseLinearSolver/SparseMatrix.h>
+#include <SofaBaseLinearSolver/FullVector.h>
+#include <SofaBaseLinearSolver/FullMatrix.h>
 #include <sofa/core/topology/BaseTopology.h>
 #include <sofa/core/topology/TopologyChange.h>
 
@@ -31,15 +37,191 @@
 
 #include <sofa/helper/accessor.h>
 
+#include <sofa/simulation/AnimateEndEvent.h>
 #include <sofa/simulation/Node.h>
 #include <sofa/simulation/Simulation.h>
 
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <limits>
+#include <sstream>
+#include <typeinfo>
 
 namespace
 {
 
+/// Pointer to the first scalar of a vector of plain Real arrays (Vec types).
+template<class V>
+typename V::value_type::value_type* flatData(V& v)
+{
+    return v.empty() ? nullptr : v[0].ptr();
+}
+
+template<class V>
+const typename V::value_type::value_type* flatData(const V& v)
+{
+    return v.empty() ? nullptr : v[0].ptr();
+}
+
+/// True if a T can be handled as an array of Real, in the order of the DataTypeInfo<T> values.
+template<class T, class Real>
+constexpr bool hasScalarLayout()
+{
+    typedef sofa::defaulttype::DataTypeInfo<T> Info;
+    return Info::SimpleLayout && std::is_same<typename Info::ValueType, Real>::value
+            && sizeof(T) == Info::Size * sizeof(Real);
+}
+
+/// Storage of a BaseVector of at least n values, or nullptr if it is not a contiguous vector of Real.
+template<class Real>
+Real* contiguousData(sofa::defaulttype::BaseVector* v, std::size_t n)
+{
+    sofa::component::linearsolver::FullVector<Real>* fv = dynamic_cast< sofa::component::linearsolver::FullVector<Real>* >(v);
+    return (fv && (std::size_t)fv->size() >= n) ? fv->ptr() : nullptr;
+}
+
+template<class Real>
+const Real* contiguousData(const sofa::defaulttype::BaseVector* v, std::size_t n)
+{
+    const sofa::component::linearsolver::FullVector<Real>* fv = dynamic_cast< const sofa::component::linearsolver::FullVector<Real>* >(v);
+    return (fv && (std::size_t)fv->size() >= n) ? fv->ptr() : nullptr;
+}
+
+/// dest[offset + k] = (or +=) k-th scalar value of src
+template<class Real, bool Add, class T>
+void toBaseVector(sofa::defaulttype::BaseVector* dest, const sofa::helper::vector<T>& src, unsigned int offset)
+{
+    typedef sofa::defaulttype::DataTypeInfo<T> Info;
+    const std::size_t n = src.size() * Info::size();
+
+    if constexpr (hasScalarLayout<T, Real>())
+    {
+        const Real* s = reinterpret_cast<const Real*>(src.data());
+        if (Real* d = contiguousData<Real>(dest, offset + n))
+        {
+            if (Add)
+                nodephysics::kernels::add(d + offset, s, n);
+            else
+                nodephysics::kernels::copy(d + offset, s, n);
+        }
+        else
+        {
+            for (std::size_t k = 0; k < n; ++k)
+            {
+                if (Add) dest->add(offset + k, s[k]);
+                else dest->set(offset + k, s[k]);
+            }
+        }
+    }
+    else
+    {
+        const unsigned int dim = Info::size();
+        for (std::size_t i = 0; i < src.size(); i++)
+        {
+            for (unsigned int j = 0; j < dim; j++)
+            {
+                Real tmp = (Real)0.0;
+                Info::getValue(src[i], j, tmp);
+                if (Add) dest->add(offset + i * dim + j, tmp);
+                else dest->set(offset + i * dim + j, tmp);
+            }
+        }
+    }
+}
+
+/// dest[i*stride + c] = c-th coordinate given by DataTypes::get for src[i], for the n first values
+/// of src, and 0 for the following ones up to nbDest.
+template<class DataTypes, class T, class V, class ParallelFor>
+void exportCoordinates(const V& src, std::size_t nbDest, T* dest, std::size_t stride, const ParallelFor& parallelFor)
+{
+    typedef typename DataTypes::Real Real;
+    typedef typename V::value_type Value;
+    const std::size_t n = std::min(nbDest, src.size());
+
+    // only Vec3 values hold their x,y,z coordinates as 3 packed Reals (Rigid2 values are x,y,theta)
+    if constexpr (std::is_same<Value, sofa::defaulttype::Vec<3, Real> >::value)
+    {
+        if (stride == 3)
+        {
+            const Real* s = flatData(src);
+            parallelFor(n, [=](std::size_t begin, std::size_t end)
+            {
+                if constexpr (std::is_same<T, Real>::value)
+                    nodephysics::kernels::copy(dest + 3 * begin, s + 3 * begin, 3 * (end - begin));
+                else
+                    nodephysics::kernels::convert(dest + 3 * begin, s + 3 * begin, 3 * (end - begin));
+            });
+            std::fill(dest + 3 * n, dest + 3 * nbDest, T(0));
+            return;
+        }
+    }
+
+    parallelFor(n, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i)
+        {
+            Real x = 0, y = 0, z = 0;
+            DataTypes::get(x, y, z, src[i]);
+            T* d = dest + i * stride;
+            d[0] = (T)x; d[1] = (T)y; d[2] = (T)z;
+        }
+    });
+    for (std::size_t i = n; i < nbDest; ++i)
+    {
+        T* d = dest + i * stride;
+        d[0] = d[1] = d[2] = T(0);
+    }
+}
+
+/// k-th scalar value of dest[first..first+nb) = (or +=) src[offset + k]
+template<class Real, bool Add, class T>
+void fromBaseVector(sofa::helper::vector<T>& dest, std::size_t first, std::size_t nb, const sofa::defaulttype::BaseVector* src, unsigned int offset)
+{
+    typedef sofa::defaulttype::DataTypeInfo<T> Info;
+    const std::size_t n = nb * Info::size();
+
+    if constexpr (hasScalarLayout<T, Real>())
+    {
+        Real* d = reinterpret_cast<Real*>(dest.data() + first);
+        if (const Real* s = contiguousData<Real>(src, offset + n))
+        {
+            if (Add)
+                nodephysics::kernels::add(d, s + offset, n);
+            else
+                nodephysics::kernels::copy(d, s + offset, n);
+        }
+        else
+        {
+            for (std::size_t k = 0; k < n; ++k)
+            {
+                if (Add) d[k] += (Real)src->element(offset + k);
+                else d[k] = (Real)src->element(offset + k);
+            }
+        }
+    }
+    else
+    {
+        const unsigned int dim = Info::size();
+        for (std::size_t i = 0; i < nb; i++)
+        {
+            for (unsigned int j = 0; j < dim; j++)
+            {
+                Real tmp = (Real)0.0;
+                if (Add)
+                    Info::getValue(dest[first + i], j, tmp);
+                Info::setValue(dest[first + i], j, tmp + (Real)src->element(offset + i * dim + j));
+            }
+        }
+    }
+}
+
 template<class V>
 void renumber(V* v, V* tmp, const sofa::helper::vector< unsigned int > &index )
 {
@@ -54,6 +236,101 @@ void renumber(V* v, V* tmp, const sofa::helper::vector< unsigned int > &index )
         (*v)[i] = (*tmp)[index[i]];
 }
 
+/// First index of each cycle of length > 1 of index, or false if index is not a permutation of [0,n).
+inline bool permutationCycles(const sofa::helper::vector< unsigned int >& index, std::vector< unsigned int >& starts)
+{
+    const std::size_t n = index.size();
+    std::vector<bool> visited(n, false);
+    starts.clear();
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        if (visited[i])
+            continue;
+        std::size_t j = i;
+        std::size_t length = 0;
+        while (!visited[j])
+        {
+            visited[j] = true;
+            ++length;
+            j = index[j];
+            if (j >= n)
+                return false;
+        }
+        if (j != i) // the path joined another cycle: some index appears twice
+            return false;
+        if (length > 1)
+            starts.push_back((unsigned int)i);
+    }
+    return true;
+}
+
+/// In-place v[i] = old v[index[i]], following the cycles of the permutation.
+template<class V>
+void permute(V& v, const sofa::helper::vector< unsigned int >& index, const std::vector< unsigned int >& starts)
+{
+    for (unsigned int start : starts)
+    {
+        const typename V::value_type first = v[start];
+        unsigned int j = start;
+        for (unsigned int k = index[j]; k != start; k = index[k])
+        {
+            v[j] = v[k];
+            j = k;
+        }
+        v[j] = first;
+    }
+}
+
+/// Flatten the ancestors lists of a topological event in CSR layout, with uniform
+/// coefs for the points whose coefs are not given.
+inline void flattenAncestors(const sofa::helper::vector< sofa::helper::vector< unsigned int > >& ancestorsList,
+                             const sofa::helper::vector< sofa::helper::vector< double > >& coefsList,
+                             sofa::helper::vector< unsigned int >& offsets,
+                             sofa::helper::vector< unsigned int >& ancestors,
+                             sofa::helper::vector< double >& coefs)
+{
+    std::size_t nbAncestors = 0;
+    for (const sofa::helper::vector< unsigned int >& a : ancestorsList)
+        nbAncestors += a.size();
+
+    offsets.resize(ancestorsList.size() + 1);
+    ancestors.resize(nbAncestors);
+    coefs.resize(nbAncestors);
+
+    std::size_t k = 0;
+    for (std::size_t i = 0; i < ancestorsList.size(); ++i)
+    {
+        offsets[i] = (unsigned int)k;
+        const std::size_t n = ancestorsList[i].size();
+        const bool hasCoefs = i < coefsList.size() && coefsList[i].size() != 0;
+        for (std::size_t j = 0; j < n; ++j, ++k)
+        {
+            ancestors[k] = ancestorsList[i][j];
+            coefs[k] = hasCoefs ? coefsList[i][j] : 1.0f / n;
+        }
+    }
+    offsets[ancestorsList.size()] = (unsigned int)k;
+}
+
+/// Parse a Real at p as operator>> would, setting end after it (end == p if there is no number).
+template<class Real>
+Real parseReal(const char* p, char** end)
+{
+    if constexpr (std::is_same<Real, float>::value)
+        return std::strtof(p, end);
+    else
+        return (Real)std::strtod(p, end);
+}
+
+/// Value written by operator<< with the default stream precision (6 significant digits), then read back.
+template<class Real>
+Real printedValue(Real v)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%g", (double)v);
+    return parseReal<Real>(buffer, nullptr);
+}
+
 } // anonymous namespace
 
 
@@ -76,6 +353,22 @@ MechanicalObject<DataTypes>::MechanicalObject()
     , reset_velocity(initData(&reset_velocity, "reset_velocity", "reset velocity coordinates of the degrees of freedom"))
     , restScale(initData(&restScale, (SReal)1.0, "restScale", "optional scaling of rest position coordinates (to simulated pre-existing internal tension).(default = 1.0)"))
     , d_useTopology(initData(&d_useTopology, true, "useTopology", "Shall this object rely on any active topology to initialize its size and positions"))
+    , d_deterministicReductions(initData(&d_deterministicReductions, false, "deterministicReductions", "Compute vDot/vSum with fixed chunking and compensated sums, so that results do not depend on the number of threads. If false, they are summed in order, or in one part per thread when run in parallel. (default=false)"))
+    , d_parallelGrainSize(initData(&d_parallelGrainSize, 0, "parallelGrainSize", "Minimum number of DOFs per task in parallel per-DOF loops. 0 disables parallelism. (default=0)"))
+    , d_vectorPool(initData(&d_vectorPool, true, "vectorPool", "Keep the buffers of freed temporary vectors, to reuse them in vAlloc. (default=true)"))
+    , d_vAllocNoInit(initData(&d_vAllocNoInit, false, "vAllocNoInit", "Do not reset the values of the buffers reused by vAlloc, for solvers overwriting the allocated vectors anyway. (default=false)"))
+    , d_vectorPoolHits(initData(&d_vectorPoolHits, 0u, "vectorPoolHits", "Number of vAlloc calls served from the pool of freed buffers"))
+    , d_vectorPoolBytes(initData(&d_vectorPoolBytes, 0ul, "vectorPoolBytes", "Memory currently retained by the pool of freed buffers, in bytes"))
+    , d_compareTolerance(initData(&d_compareTolerance, (SReal)0, "compareTolerance", "Maximal absolute difference accepted by compareVec, larger ones are reported. 0 disables the check. (default=0)"))
+    , d_trackDirtyRanges(initData(&d_trackDirtyRanges, false, "trackDirtyRanges", "Record the index ranges modified in the state vectors, see markDirty and getDirtyRanges. (default=false)"))
+    , d_spatialIndex(initData(&d_spatialIndex, false, "spatialIndex", "Accelerate getIndicesInSpace, pickParticles and getNearestParticles with a uniform grid over the positions, rebuilt when they change. (default=false)"))
+    , d_normalizeOrientations(initData(&d_normalizeOrientations, false, "normalizeOrientations", "Rigid3 only: scale the orientation quaternions back to unit length after each position update. (default=false)"))
+    , d_sparseForces(initData(&d_sparseForces, false, "sparseForces", "Reset the force only on the DOFs of the activated force mask, and accumulate only the external forces given to addExternalForce. Requires force fields honouring the mask. (default=false)"))
+    , d_probeNames(initData(&d_probeNames, "probeNames", "Instrumented functions, built with NODEPHYSICS_INSTRUMENTATION"))
+    , d_probeCalls(initData(&d_probeCalls, "probeCalls", "Number of calls of each instrumented function, updated at the end of each step"))
+    , d_probeCycles(initData(&d_probeCycles, "probeCycles", "Cycles (time stamp counter) spent in each instrumented function, updated at the end of each step"))
+    , d_probeBytes(initData(&d_probeBytes, "probeBytes", "Estimated bytes of state read and written by each instrumented function, updated at the end of each step"))
+    , d_probeFile(initData(&d_probeFile, "probeFile", "File the statistics of the instrumented functions are appended to in JSON at cleanup. Empty for none."))
     , showObject(initData(&showObject, (bool) false, "showObject", "Show objects. (default=false)"))
     , showObjectScale(initData(&showObjectScale, (float) 0.1, "showObjectScale", "Scale for object display. (default=0.1)"))
     , showIndices(initData(&showIndices, (bool) false, "showIndices", "Show indices. (default=false)"))
@@ -110,6 +403,23 @@ MechanicalObject<DataTypes>::MechanicalObject()
     reset_position  .setGroup("Vector");
     reset_velocity  .setGroup("Vector");
 
+    d_vectorPoolHits.setReadOnly(true);
+    d_vectorPoolBytes.setReadOnly(true);
+
+    d_probeNames    .setGroup("Instrumentation");
+    d_probeCalls    .setGroup("Instrumentation");
+    d_probeCycles   .setGroup("Instrumentation");
+    d_probeBytes    .setGroup("Instrumentation");
+    d_probeFile     .setGroup("Instrumentation");
+    d_probeNames.setReadOnly(true);
+    d_probeCalls.setReadOnly(true);
+    d_probeCycles.setReadOnly(true);
+    d_probeBytes.setReadOnly(true);
+#ifdef NODEPHYSICS_INSTRUMENTATION
+    d_probeNames.setValue(helper::vector<std::string>(m_probes.getNames().begin(), m_probes.getNames().end()));
+    this->f_listening.setValue(true);
+#endif
+
     translation     .setGroup("Transformation");
     translation2    .setGroup("Transformation");
     rotation        .setGroup("Transformation");
@@ -242,6 +552,7 @@ void MechanicalObject<DataTypes>::parse ( sofa::core::objectmodel::BaseObjectDes
 template <class DataTypes>
 void MechanicalObject<DataTypes>::handleStateChange()
 {
+    NODEPHYSICS_PROBE(m_probes, ProbeHandleStateChange, 0);
     if (!l_topology) return;
 
     using sofa::core::topology::TopologyChange;
@@ -286,34 +597,18 @@ void MechanicalObject<DataTypes>::handleStateChange()
                 }
             }
 
-            vector< vector< unsigned int > > ancestors = pointsAdded.ancestorsList;
-            vector< vector< double       > > coefs     = pointsAdded.coefs;
-
             resize(prevSizeMechObj + nbPoints);
 
-            if (!ancestors.empty() )
+            if (!pointsAdded.ancestorsList.empty() )
             {
-                vector< vector< double > > coefs2;
-                coefs2.resize(ancestors.size());
-
-                for (unsigned int i = 0; i < ancestors.size(); ++i)
-                {
-                    coefs2[i].resize(ancestors[i].size());
-
-                    for (unsigned int j = 0; j < ancestors[i].size(); ++j)
-                    {
-                        // constructng default coefs if none were defined
-                        if (coefs == (const vector< vector< double > >)0 || coefs[i].size() == 0)
-                            coefs2[i][j] = 1.0f / ancestors[i].size();
-                        else
-                            coefs2[i][j] = coefs[i][j];
-                    }
-                }
-
-                for (unsigned int i = 0; i < ancestors.size(); ++i)
-                {
-                    computeWeightedValue( prevSizeMechObj + i, ancestors[i], coefs2[i] );
-                }
+                vector< unsigned int > indices(pointsAdded.ancestorsList.size());
+                for (unsigned int i = 0; i < indices.size(); ++i)
+                    indices[i] = prevSizeMechObj + i;
+
+                vector< unsigned int > offsets, ancestors;
+                vector< double > coefs;
+                flattenAncestors(pointsAdded.ancestorsList, pointsAdded.coefs, offsets, ancestors, coefs);
+                computeWeightedValues( indices, offsets, ancestors, coefs );
             }
 
             if (!pointsAdded.ancestorElems.empty() && (geoAlgo != nullptr))
@@ -354,54 +649,27 @@ void MechanicalObject<DataTypes>::handleStateChange()
         }
         case core::topology::POINTSREMOVED:
         {
-            const sofa::helper::vector<unsigned int> tab = ( static_cast< const PointsRemoved * >( *itBegin ) )->getArray();
+            const sofa::helper::vector<unsigned int>& tab = ( static_cast< const PointsRemoved * >( *itBegin ) )->getArray();
 
-            unsigned int prevSizeMechObj   = getSize();
-            unsigned int lastIndexMech = prevSizeMechObj - 1;
-            for (unsigned int i = 0; i < tab.size(); ++i)
-            {
-                replaceValue(lastIndexMech, tab[i] );
-
-                --lastIndexMech;
-            }
-            resize( prevSizeMechObj - tab.size() );
+            removeValues( tab );
             break;
         }
         case core::topology::POINTSMOVED:
         {
             using sofa::helper::vector;
 
-            const vector< unsigned int > indicesList = ( static_cast <const PointsMoved *> (*itBegin))->indicesList;
-            const vector< vector< unsigned int > > ancestors = ( static_cast< const PointsMoved * >( *itBegin ) )->ancestorsList;
-            const vector< vector< double > > coefs = ( static_cast< const PointsMoved * >( *itBegin ) )->baryCoefsList;
+            const PointsMoved &pointsMoved = *static_cast< const PointsMoved * >( *itBegin );
 
-            if (ancestors.size() != indicesList.size() || ancestors.empty())
+            if (pointsMoved.ancestorsList.size() != pointsMoved.indicesList.size() || pointsMoved.ancestorsList.empty())
             {
                 msg_error() << "Error ! MechanicalObject::POINTSMOVED topological event, bad inputs (inputs don't share the same size or are empty).";
                 break;
             }
 
-            vector< vector < double > > coefs2;
-            coefs2.resize (coefs.size());
-
-            for (unsigned int i = 0; i<ancestors.size(); ++i)
-            {
-                coefs2[i].resize(ancestors[i].size());
-
-                for (unsigned int j = 0; j < ancestors[i].size(); ++j)
-                {
-                    // constructng default coefs if none were defined
-                    if (coefs == (const vector< vector< double > >)0 || coefs[i].size() == 0)
-                        coefs2[i][j] = 1.0f / ancestors[i].size();
-                    else
-                        coefs2[i][j] = coefs[i][j];
-                }
-            }
-
-            for (unsigned int i = 0; i < indicesList.size(); ++i)
-            {
-                computeWeightedValue( indicesList[i], ancestors[i], coefs2[i] );
-            }
+            vector< unsigned int > offsets, ancestors;
+            vector< double > coefs;
+            flattenAncestors(pointsMoved.ancestorsList, pointsMoved.baryCoefsList, offsets, ancestors, coefs);
+            computeWeightedValues( pointsMoved.indicesList, offsets, ancestors, coefs );
 
             break;
         }
@@ -425,6 +693,7 @@ void MechanicalObject<DataTypes>::handleStateChange()
 template <class DataTypes>
 void MechanicalObject<DataTypes>::replaceValue (const int inputIndex, const int outputIndex)
 {
+    m_forceDofsValid = false; // the forces move to other DOFs
     //const unsigned int maxIndex = std::max(inputIndex, outputIndex);
     const unsigned int maxIndex = inputIndex<outputIndex ? outputIndex : inputIndex;
     const unsigned int vecCoordSize = vectorsCoord.size();
@@ -438,6 +707,7 @@ void MechanicalObject<DataTypes>::replaceValue (const int inputIndex, const int
                 vector[outputIndex] = vector[inputIndex];
 
             vectorsCoord[i]->endEdit();
+            markDirty(core::ConstVecCoordId(i), outputIndex, outputIndex + 1);
         }
     }
 
@@ -452,6 +722,7 @@ void MechanicalObject<DataTypes>::replaceValue (const int inputIndex, const int
                 vector[outputIndex] = vector[inputIndex];
 
             vectorsDeriv[i]->endEdit();
+            markDirty(core::ConstVecDerivId(i), outputIndex, outputIndex + 1);
         }
     }
 }
@@ -459,6 +730,7 @@ void MechanicalObject<DataTypes>::replaceValue (const int inputIndex, const int
 template <class DataTypes>
 void MechanicalObject<DataTypes>::swapValues (const int idx1, const int idx2)
 {
+    m_forceDofsValid = false; // the forces move to other DOFs
     //const unsigned int maxIndex = std::max(idx1, idx2);
     const unsigned int maxIndex = idx1<idx2 ? idx2 : idx1;
 
@@ -477,6 +749,8 @@ void MechanicalObject<DataTypes>::swapValues (const int idx1, const int idx2)
                 vector[idx2] = tmp;
             }
             vectorsCoord[i]->endEdit();
+            markDirty(core::ConstVecCoordId(i), idx1, idx1 + 1);
+            markDirty(core::ConstVecCoordId(i), idx2, idx2 + 1);
         }
     }
     for (i=0; i<vectorsDeriv.size(); i++)
@@ -491,38 +765,184 @@ void MechanicalObject<DataTypes>::swapValues (const int idx1, const int idx2)
                 vector[idx2] = tmp2;
             }
             vectorsDeriv[i]->endEdit();
+            markDirty(core::ConstVecDerivId(i), idx1, idx1 + 1);
+            markDirty(core::ConstVecDerivId(i), idx2, idx2 + 1);
         }
     }
 }
 
 template <class DataTypes>
-void MechanicalObject<DataTypes>::renumberValues( const sofa::helper::vector< unsigned int > &index )
+void MechanicalObject<DataTypes>::removeValues( const sofa::helper::vector<unsigned int>& indices )
 {
-    VecDeriv dtmp;
-    VecCoord ctmp;
+    const std::size_t prevSize = getSize();
+    const std::size_t nbRemoved = indices.size();
+    if (nbRemoved == 0)
+        return;
+    if (nbRemoved > prevSize)
+    {
+        msg_error() << "removeValues: cannot remove " << nbRemoved << " values from " << prevSize;
+        return;
+    }
+    const std::size_t newSize = prevSize - nbRemoved;
+
+    // Moves done by the successive replaceValue(last, indices[i]) calls, expressed from the
+    // original values: the sources all lie in the removed tail [newSize,prevSize) and only the
+    // destinations below newSize are kept, so that no move reads a value written by another one.
+    std::vector<unsigned int> tailSource(nbRemoved); // original index of the value now at newSize+k
+    for (std::size_t k = 0; k < nbRemoved; ++k)
+        tailSource[k] = (unsigned int)(newSize + k);
+
+    std::vector< std::pair<unsigned int, unsigned int> > moves; // (destination, source), in order
+    moves.reserve(nbRemoved);
+    for (std::size_t i = 0; i < nbRemoved; ++i)
+    {
+        const unsigned int source = tailSource[prevSize - 1 - i - newSize];
+        const unsigned int destination = indices[i];
+        if (destination >= prevSize)
+            continue;
+        if (destination >= newSize)
+            tailSource[destination - newSize] = source;
+        else
+            moves.emplace_back(destination, source);
+    }
 
+    // one edit for each vector, the moves of different vectors being done in parallel
+    std::vector<VecCoord*> coords;
+    std::vector<VecDeriv*> derivs;
     for (unsigned int i = 0; i < vectorsCoord.size(); ++i)
+        coords.push_back(vectorsCoord[i] != nullptr ? vectorsCoord[i]->beginEdit() : nullptr);
+    for (unsigned int i = 0; i < vectorsDeriv.size(); ++i)
+        derivs.push_back(vectorsDeriv[i] != nullptr ? vectorsDeriv[i]->beginEdit() : nullptr);
+
+    auto applyMoves = [&moves](auto* vector)
+    {
+        if (vector == nullptr)
+            return;
+        for (const std::pair<unsigned int, unsigned int>& m : moves)
+            if (m.second < vector->size())
+                (*vector)[m.first] = (*vector)[m.second];
+    };
+    auto task = [&](std::size_t k)
     {
+        if (k < coords.size())
+            applyMoves(coords[k]);
+        else
+            applyMoves(derivs[k - coords.size()]);
+    };
+    const std::size_t nbVectors = coords.size() + derivs.size();
+    const int grain = d_parallelGrainSize.getValue();
+    if (grain > 0 && moves.size() > (std::size_t)grain)
+        nodephysics::TaskPool::getInstance().run(nbVectors, task);
+    else
+        for (std::size_t k = 0; k < nbVectors; ++k)
+            task(k);
+
+    for (unsigned int i = 0; i < vectorsCoord.size(); ++i)
         if (vectorsCoord[i] != nullptr)
-        {
-            renumber(vectorsCoord[i]->beginEdit(), &ctmp, index);
             vectorsCoord[i]->endEdit();
+    for (unsigned int i = 0; i < vectorsDeriv.size(); ++i)
+        if (vectorsDeriv[i] != nullptr)
+            vectorsDeriv[i]->endEdit();
+
+    if (d_trackDirtyRanges.getValue())
+    {
+        std::vector<unsigned int> destinations;
+        destinations.reserve(moves.size());
+        for (const std::pair<unsigned int, unsigned int>& m : moves)
+            destinations.push_back(m.first);
+        std::sort(destinations.begin(), destinations.end());
+        for (unsigned int i = 0; i < vectorsCoord.size(); ++i)
+            if (vectorsCoord[i] != nullptr)
+                for (unsigned int d : destinations)
+                    markDirty(core::ConstVecCoordId(i), d, d + 1);
+        for (unsigned int i = 0; i < vectorsDeriv.size(); ++i)
+            if (vectorsDeriv[i] != nullptr)
+                for (unsigned int d : destinations)
+                    markDirty(core::ConstVecDerivId(i), d, d + 1);
+    }
+
+    resize(newSize);
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::renumberValues( const sofa::helper::vector< unsigned int > &index )
+{
+    m_forceDofsValid = false; // the forces move to other DOFs
+    std::vector< unsigned int > starts;
+    if (!permutationCycles(index, starts))
+    {
+        // not a permutation, values are duplicated: use a copy of each vector
+        VecDeriv dtmp;
+        VecCoord ctmp;
+
+        for (unsigned int i = 0; i < vectorsCoord.size(); ++i)
+        {
+            if (vectorsCoord[i] != nullptr)
+            {
+                renumber(vectorsCoord[i]->beginEdit(), &ctmp, index);
+                vectorsCoord[i]->endEdit();
+            }
+        }
+
+        for (unsigned int i = 0; i < vectorsDeriv.size(); ++i)
+        {
+            if (vectorsDeriv[i] != nullptr)
+            {
+                renumber(vectorsDeriv[i]->beginEdit(), &dtmp, index);
+                vectorsDeriv[i]->endEdit();
+            }
         }
+        return;
     }
 
+    // permute all the vectors in place and concurrently, each one following the cycles
+    std::vector<VecCoord*> coords;
+    std::vector<VecDeriv*> derivs;
+    for (unsigned int i = 0; i < vectorsCoord.size(); ++i)
+        coords.push_back(vectorsCoord[i] != nullptr ? vectorsCoord[i]->beginEdit() : nullptr);
     for (unsigned int i = 0; i < vectorsDeriv.size(); ++i)
+        derivs.push_back(vectorsDeriv[i] != nullptr ? vectorsDeriv[i]->beginEdit() : nullptr);
+
+    auto permuteVector = [&index, &starts](auto* vector)
     {
-        if (vectorsDeriv[i] != nullptr)
+        if (vector == nullptr || vector->empty())
+            return;
+        if (vector->size() == index.size())
+            permute(*vector, index, starts);
+        else
         {
-            renumber(vectorsDeriv[i]->beginEdit(), &dtmp, index);
-            vectorsDeriv[i]->endEdit();
+            typename std::remove_pointer<decltype(vector)>::type tmp;
+            renumber(vector, &tmp, index);
         }
-    }
+    };
+    auto task = [&](std::size_t k)
+    {
+        if (k < coords.size())
+            permuteVector(coords[k]);
+        else
+            permuteVector(derivs[k - coords.size()]);
+    };
+    const std::size_t nbVectors = coords.size() + derivs.size();
+    const int grain = d_parallelGrainSize.getValue();
+    if (grain > 0 && index.size() > (std::size_t)grain)
+        nodephysics::TaskPool::getInstance().run(nbVectors, task);
+    else
+        for (std::size_t k = 0; k < nbVectors; ++k)
+            task(k);
+
+    for (unsigned int i = 0; i < vectorsCoord.size(); ++i)
+        if (vectorsCoord[i] != nullptr)
+            vectorsCoord[i]->endEdit();
+    for (unsigned int i = 0; i < vectorsDeriv.size(); ++i)
+        if (vectorsDeriv[i] != nullptr)
+            vectorsDeriv[i]->endEdit();
 }
 
 template <class DataTypes>
 void MechanicalObject<DataTypes>::resize(const size_t size)
 {
+    if ((size_t)d_size.getValue() != size)
+        m_forceDofsValid = false;
 
 
     if(size>0)
@@ -603,11 +1023,16 @@ template <class DataTypes>
 void MechanicalObject<DataTypes>::applyTranslation (const SReal dx, const SReal dy, const SReal dz)
 {
     helper::WriteAccessor< Data<VecCoord> > x_wA = *this->write(core::VecCoordId::position());
+    VecCoord& x = x_wA.wref();
 
-    for (unsigned int i = 0; i < x_wA.size(); i++)
+    parallelForDofs(x.size(), [&](std::size_t begin, std::size_t end)
     {
-        DataTypes::add(x_wA[i], dx, dy, dz);
-    }
+        for (std::size_t i = begin; i < end; i++)
+        {
+            DataTypes::add(x[i], dx, dy, dz);
+        }
+    });
+    markDirty(core::ConstVecCoordId::position());
 }
 
 //Apply Rotation from Euler angles (in degree!)
@@ -623,14 +1048,19 @@ template <class DataTypes>
 void MechanicalObject<DataTypes>::applyRotation (const defaulttype::Quat q)
 {
     helper::WriteAccessor< Data<VecCoord> > x_wA = *this->write(core::VecCoordId::position());
+    VecCoord& x = x_wA.wref();
 
-    for (unsigned int i = 0; i < x_wA.size(); i++)
+    parallelForDofs(x.size(), [&](std::size_t begin, std::size_t end)
     {
-        sofa::defaulttype::Vec<3,Real> pos;
-        DataTypes::get(pos[0], pos[1], pos[2], x_wA[i]);
-        sofa::defaulttype::Vec<3,Real> newposition = q.rotate(pos);
-        DataTypes::set(x_wA[i], newposition[0], newposition[1], newposition[2]);
-    }
+        for (std::size_t i = begin; i < end; i++)
+        {
+            sofa::defaulttype::Vec<3,Real> pos;
+            DataTypes::get(pos[0], pos[1], pos[2], x[i]);
+            sofa::defaulttype::Vec<3,Real> newposition = q.rotate(pos);
+            DataTypes::set(x[i], newposition[0], newposition[1], newposition[2]);
+        }
+    });
+    markDirty(core::ConstVecCoordId::position());
 }
 
 template <class DataTypes>
@@ -638,18 +1068,34 @@ void MechanicalObject<DataTypes>::applyScale(const SReal sx,const SReal sy,const
 {
     helper::WriteAccessor< Data<VecCoord> > x_wA = this->writePositions();
 
+    VecCoord& x = x_wA.wref();
+
     const sofa::defaulttype::Vec<3,Real> s((Real)sx, (Real)sy, (Real)sz);
-    for (unsigned int i=0; i<x_wA.size(); i++)
+    parallelForDofs(x.size(), [&](std::size_t begin, std::size_t end)
     {
-        x_wA[i][0] = x_wA[i][0] * s[0];
-        x_wA[i][1] = x_wA[i][1] * s[1];
-        x_wA[i][2] = x_wA[i][2] * s[2];
-    }
+        for (std::size_t i = begin; i < end; i++)
+        {
+            x[i][0] = x[i][0] * s[0];
+            x[i][1] = x[i][1] * s[1];
+            x[i][2] = x[i][2] * s[2];
+        }
+    });
+    markDirty(core::ConstVecCoordId::position());
 }
 
 template <class DataTypes>
 void MechanicalObject<DataTypes>::getIndicesInSpace(sofa::helper::vector<unsigned>& indices, Real xmin, Real xmax, Real ymin, Real ymax, Real zmin, Real zmax) const
 {
+    if (const SpatialGrid* grid = getSpatialGrid())
+    {
+        const double min[3] = { (double)xmin, (double)ymin, (double)zmin };
+        const double max[3] = { (double)xmax, (double)ymax, (double)zmax };
+        std::vector<unsigned int> found;
+        grid->queryBox(min, max, found);
+        indices.insert(indices.end(), found.begin(), found.end());
+        return;
+    }
+
     helper::ReadAccessor< Data<VecCoord> > x_rA = this->readPositions();
 
     for( unsigned i=0; i<x_rA.size(); ++i )
@@ -664,89 +1110,266 @@ void MechanicalObject<DataTypes>::getIndicesInSpace(sofa::helper::vector<unsigne
 }
 
 template <class DataTypes>
-void MechanicalObject<DataTypes>::computeWeightedValue( const unsigned int i, const sofa::helper::vector< unsigned int >& ancestors, const sofa::helper::vector< double >& coefs)
+size_t MechanicalObject<DataTypes>::exportPositions(double* positions, size_t stride, double* velocities) const
 {
-    // HD interpolate position, speed,force,...
-    // assume all coef sum to 1.0
-    unsigned int j;
-
-    const unsigned int ancestorsSize = ancestors.size();
+    return exportPositionsAs(positions, stride, velocities);
+}
 
-    helper::vector< Coord > ancestorsCoord(ancestorsSize);
-    helper::vector< Deriv > ancestorsDeriv(ancestorsSize);
-    helper::vector< Real > ancestorsCoefs(ancestorsSize);
+template <class DataTypes>
+size_t MechanicalObject<DataTypes>::exportPositions(float* positions, size_t stride, float* velocities) const
+{
+    return exportPositionsAs(positions, stride, velocities);
+}
 
-    for (unsigned int k = 0; k < vectorsCoord.size(); k++)
+template <class DataTypes>
+template <class T>
+size_t MechanicalObject<DataTypes>::exportPositionsAs(T* positions, size_t stride, T* velocities) const
+{
+    if (stride < 3)
     {
-        if (vectorsCoord[k] != nullptr)
-        {
-            VecCoord &vecCoord = *(vectorsCoord[k]->beginEdit());
-
-            if (vecCoord.size() != 0)
-            {
-                for (j = 0; j < ancestorsSize; ++j)
-                {
-                    ancestorsCoord[j] = vecCoord[ancestors[j]];
-                    ancestorsCoefs[j] = (Real)coefs[j];
-                }
+        msg_error() << "exportPositions: invalid stride " << stride << ", at least 3 values per DOF are written";
+        return 0;
+    }
 
-                vecCoord[i] = DataTypes::interpolate(ancestorsCoord, ancestorsCoefs);
-            }
+    helper::ReadAccessor< Data<VecCoord> > x = *this->read(core::ConstVecCoordId::position());
+    const size_t n = std::min((size_t)d_size.getValue(), x.size());
+    const auto parallelFor = [this](std::size_t nb, const auto& f) { parallelForDofs(nb, f); };
 
-            vectorsCoord[k]->endEdit();
-        }
+    exportCoordinates<DataTypes>(x.ref(), n, positions, stride, parallelFor);
+    if (velocities)
+    {
+        helper::ReadAccessor< Data<VecDeriv> > v = *this->read(core::ConstVecDerivId::velocity());
+        exportCoordinates<DataTypes>(v.ref(), n, velocities, stride, parallelFor);
     }
+    return n;
+}
 
-    for (unsigned int k = 0; k < vectorsDeriv.size(); k++)
+template <class DataTypes>
+void MechanicalObject<DataTypes>::getNearestParticles(const defaulttype::Vector3& p, unsigned int k, sofa::helper::vector<unsigned>& indices) const
+{
+    indices.clear();
+    std::vector< std::pair<double, unsigned int> > nearest;
+    if (const SpatialGrid* grid = getSpatialGrid())
     {
-        if (vectorsDeriv[k] != nullptr)
+        const double q[3] = { (double)p[0], (double)p[1], (double)p[2] };
+        grid->queryNearest(q, k, nearest);
+    }
+    else
+    {
+        helper::ReadAccessor< Data<VecCoord> > x_rA = this->readPositions();
+        nearest.resize(x_rA.size());
+        for (unsigned int i = 0; i < x_rA.size(); ++i)
         {
-            VecDeriv &vecDeriv = *(vectorsDeriv[k]->beginEdit());
+            Real x=0.0,y=0.0,z=0.0;
+            DataTypes::get(x,y,z,x_rA[i]);
+            nearest[i] = std::make_pair((x-p[0])*(x-p[0]) + (y-p[1])*(y-p[1]) + (z-p[2])*(z-p[2]), i);
+        }
+        const std::size_t n = std::min<std::size_t>(k, nearest.size());
+        std::partial_sort(nearest.begin(), nearest.begin() + n, nearest.end());
+        nearest.resize(n);
+    }
 
-            if (vecDeriv.size() != 0)
-            {
-                for (j = 0; j < ancestorsSize; ++j)
-                {
-                    ancestorsDeriv[j] = vecDeriv[ancestors[j]];
-                    ancestorsCoefs[j] = (Real)coefs[j];
-                }
+    indices.reserve(nearest.size());
+    for (const std::pair<double, unsigned int>& d : nearest)
+        indices.push_back(d.second);
+}
 
-                vecDeriv[i] = DataTypes::interpolate(ancestorsDeriv, ancestorsCoefs);
+template <class DataTypes>
+const SpatialGrid* MechanicalObject<DataTypes>::getSpatialGrid() const
+{
+    if (!d_spatialIndex.getValue())
+        return nullptr;
+
+    const Data<VecCoord>* positions = this->read(core::ConstVecCoordId::position());
+    const VecCoord& x = positions->getValue();
+    const int counter = positions->getCounter();
+    if (counter != m_spatialGridCounter || m_spatialGrid.getNbPoints() != x.size())
+    {
+        std::vector<double> points(3 * x.size());
+        parallelForDofs(x.size(), [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                Real px=0.0,py=0.0,pz=0.0;
+                DataTypes::get(px,py,pz,x[i]);
+                points[3*i] = px;
+                points[3*i+1] = py;
+                points[3*i+2] = pz;
             }
+        });
+        m_spatialGrid.build(std::move(points));
+        m_spatialGridCounter = counter;
+    }
+    return &m_spatialGrid;
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::computeWeightedValue( const unsigned int i, const sofa::helper::vector< unsigned int >& ancestors, const sofa::helper::vector< double >& coefs)
+{
+    // HD interpolate position, speed,force,...
+    // assume all coef sum to 1.0
+    const sofa::helper::vector< unsigned int > indices(1, i);
+    sofa::helper::vector< unsigned int > offsets(2, 0);
+    offsets[1] = (unsigned int)ancestors.size();
+    computeWeightedValues(indices, offsets, ancestors, coefs);
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::computeWeightedValues( const sofa::helper::vector< unsigned int >& indices, const sofa::helper::vector< unsigned int >& offsets,
+                                                         const sofa::helper::vector< unsigned int >& ancestors, const sofa::helper::vector< double >& coefs)
+{
+    const std::size_t nbValues = indices.size();
+    if (nbValues == 0)
+        return;
+    if (offsets.size() != nbValues + 1 || offsets[nbValues] > ancestors.size() || coefs.size() < ancestors.size())
+    {
+        msg_error() << "computeWeightedValues: invalid ancestors layout";
+        return;
+    }
 
+    const std::size_t size = getSize();
+    for (unsigned int i : indices)
+    {
+        if (i >= size)
+        {
+            msg_error() << "computeWeightedValues: index " << i << " out of range (size " << size << ")";
+            return;
+        }
+    }
+    for (std::size_t k = offsets[0]; k < offsets[nbValues]; ++k)
+    {
+        if (ancestors[k] >= size)
+        {
+            msg_error() << "computeWeightedValues: ancestor " << ancestors[k] << " out of range (size " << size << ")";
+            return;
+        }
+    }
+
+    // values can be computed in parallel unless one of them is an ancestor of another one
+    bool parallel = nbValues > 1;
+    if (parallel)
+    {
+        std::vector<unsigned int> sorted(indices.begin(), indices.end());
+        std::sort(sorted.begin(), sorted.end());
+        for (std::size_t k = offsets[0]; parallel && k < offsets[nbValues]; ++k)
+            parallel = !std::binary_search(sorted.begin(), sorted.end(), ancestors[k]);
+    }
+
+    for (unsigned int k = 0; k < vectorsCoord.size(); k++)
+    {
+        if (vectorsCoord[k] != nullptr)
+        {
+            VecCoord &vecCoord = *(vectorsCoord[k]->beginEdit());
+            if (vecCoord.size() >= size)
+                interpolateValues(vecCoord, indices, offsets, ancestors, coefs, parallel);
+            vectorsCoord[k]->endEdit();
+        }
+    }
+
+    for (unsigned int k = 0; k < vectorsDeriv.size(); k++)
+    {
+        if (vectorsDeriv[k] != nullptr)
+        {
+            VecDeriv &vecDeriv = *(vectorsDeriv[k]->beginEdit());
+            if (vecDeriv.size() >= size)
+                interpolateValues(vecDeriv, indices, offsets, ancestors, coefs, parallel);
             vectorsDeriv[k]->endEdit();
         }
     }
+
+    if (d_trackDirtyRanges.getValue())
+    {
+        std::vector<unsigned int> sorted(indices.begin(), indices.end());
+        std::sort(sorted.begin(), sorted.end());
+        for (unsigned int k = 0; k < vectorsCoord.size(); k++)
+            if (vectorsCoord[k] != nullptr)
+                for (unsigned int i : sorted)
+                    markDirty(core::ConstVecCoordId(k), i, i + 1);
+        for (unsigned int k = 0; k < vectorsDeriv.size(); k++)
+            if (vectorsDeriv[k] != nullptr)
+                for (unsigned int i : sorted)
+                    markDirty(core::ConstVecDerivId(k), i, i + 1);
+    }
+}
+
+template <class DataTypes>
+template <class VecType>
+void MechanicalObject<DataTypes>::interpolateValues(VecType& vec, const sofa::helper::vector< unsigned int >& indices, const sofa::helper::vector< unsigned int >& offsets,
+                                                    const sofa::helper::vector< unsigned int >& ancestors, const sofa::helper::vector< double >& coefs, bool parallel) const
+{
+    typedef typename VecType::value_type Value;
+
+    auto interpolate = [&](std::size_t begin, std::size_t end)
+    {
+        if constexpr (FlatLayout)
+        {
+            // weighted sum of plain arrays, as DataTypes::interpolate does for Vec types
+            constexpr std::size_t dim = defaulttype::DataTypeInfo<Value>::Size;
+            Real* data = reinterpret_cast<Real*>(vec.data());
+            for (std::size_t p = begin; p < end; ++p)
+            {
+                Real value[dim] = {};
+                for (std::size_t k = offsets[p]; k < offsets[p + 1]; ++k)
+                {
+                    const Real* a = data + (std::size_t)ancestors[k] * dim;
+                    const Real c = (Real)coefs[k];
+                    for (std::size_t d = 0; d < dim; ++d)
+                        value[d] += a[d] * c;
+                }
+                std::copy(value, value + dim, data + (std::size_t)indices[p] * dim);
+            }
+        }
+        else
+        {
+            // buffers reused for all the values of the range
+            helper::vector< Value > ancestorsValues;
+            helper::vector< Real > ancestorsCoefs;
+            for (std::size_t p = begin; p < end; ++p)
+            {
+                const std::size_t n = offsets[p + 1] - offsets[p];
+                ancestorsValues.resize(n);
+                ancestorsCoefs.resize(n);
+                for (std::size_t j = 0; j < n; ++j)
+                {
+                    ancestorsValues[j] = vec[ancestors[offsets[p] + j]];
+                    ancestorsCoefs[j] = (Real)coefs[offsets[p] + j];
+                }
+                vec[indices[p]] = DataTypes::interpolate(ancestorsValues, ancestorsCoefs);
+            }
+        }
+    };
+
+    if (parallel)
+        parallelForDofs(indices.size(), interpolate);
+    else
+        interpolate(0, indices.size());
 }
 
 // Force the position of a point (and force its velocity to zero value)
 template <class DataTypes>
 void MechanicalObject<DataTypes>::forcePointPosition(const unsigned int i, const sofa::helper::vector< double >& m_x)
 {
-    helper::WriteAccessor< Data<VecCoord> > x_wA = this->writePositions();
-    helper::WriteAccessor< Data<VecDeriv> > v_wA = this->writeVelocities();
+    {
+        helper::WriteAccessor< Data<VecCoord> > x_wA = this->writePositions();
+        helper::WriteAccessor< Data<VecDeriv> > v_wA = this->writeVelocities();
 
-    DataTypes::set(x_wA[i], m_x[0], m_x[1], m_x[2]);
-    DataTypes::set(v_wA[i], (Real) 0.0, (Real) 0.0, (Real) 0.0);
+        DataTypes::set(x_wA[i], m_x[0], m_x[1], m_x[2]);
+        DataTypes::set(v_wA[i], (Real) 0.0, (Real) 0.0, (Real) 0.0);
+    }
+    markDirty(core::ConstVecCoordId::position(), i, i + 1);
+    markDirty(core::ConstVecDerivId::velocity(), i, i + 1);
 }
 
 template <class DataTypes>
 void MechanicalObject<DataTypes>::copyToBaseVector(defaulttype::BaseVector * dest, core::ConstVecId src, unsigned int &offset)
 {
+    NODEPHYSICS_PROBE(m_probes, ProbeCopyToBaseVector, 2 * getProbeBytes(src));
     if (src.type == sofa::core::V_COORD)
     {
         helper::ReadAccessor< Data<VecCoord> > vSrc = *this->read(sofa::core::ConstVecCoordId(src));
         const unsigned int coordDim = sofa::defaulttype::DataTypeInfo<Coord>::size();
 
-        for (unsigned int i = 0; i < vSrc.size(); i++)
-        {
-            for (unsigned int j = 0; j < coordDim; j++)
-            {
-                Real tmp = (Real)0.0;
-                sofa::defaulttype::DataTypeInfo<Coord>::getValue(vSrc[i], j, tmp);
-                dest->set(offset + i * coordDim + j, tmp);
-            }
-        }
+        toBaseVector<Real, false>(dest, vSrc.ref(), offset);
 
         offset += vSrc.size() * coordDim;
     }
@@ -755,15 +1378,7 @@ void MechanicalObject<DataTypes>::copyToBaseVector(defaulttype::BaseVector * des
         helper::ReadAccessor< Data<VecDeriv> > vSrc = *this->read(sofa::core::ConstVecDerivId(src));
         const unsigned int derivDim = defaulttype::DataTypeInfo<Deriv>::size();
 
-        for (unsigned int i = 0; i < vSrc.size(); i++)
-        {
-            for (unsigned int j = 0; j < derivDim; j++)
-            {
-                Real tmp;
-                sofa::defaulttype::DataTypeInfo<Deriv>::getValue(vSrc[i], j, tmp);
-                dest->set(offset + i * derivDim + j, tmp);
-            }
-        }
+        toBaseVector<Real, false>(dest, vSrc.ref(), offset);
 
         offset += vSrc.size() * derivDim;
     }
@@ -772,20 +1387,14 @@ void MechanicalObject<DataTypes>::copyToBaseVector(defaulttype::BaseVector * des
 template <class DataTypes>
 void MechanicalObject<DataTypes>::copyFromBaseVector(sofa::core::VecId dest, const defaulttype::BaseVector *src, unsigned int &offset)
 {
+    NODEPHYSICS_PROBE(m_probes, ProbeCopyFromBaseVector, 2 * getProbeBytes(dest));
     if (dest.type == sofa::core::V_COORD)
     {
         helper::WriteOnlyAccessor< Data<VecCoord> > vDest = *this->write(sofa::core::VecCoordId(dest));
         const unsigned int coordDim = defaulttype::DataTypeInfo<Coord>::size();
 
-        for (unsigned int i = 0; i < vDest.size(); i++)
-        {
-            for (unsigned int j = 0; j < coordDim; j++)
-            {
-                Real tmp;
-                tmp = (Real)src->element(offset + i * coordDim + j);
-                sofa::defaulttype::DataTypeInfo<Coord>::setValue(vDest[i], j, tmp);
-            }
-        }
+        fromBaseVector<Real, false>(vDest.wref(), 0, vDest.size(), src, offset);
+        markDirty(dest);
 
         offset += vDest.size() * coordDim;
     }
@@ -794,15 +1403,8 @@ void MechanicalObject<DataTypes>::copyFromBaseVector(sofa::core::VecId dest, con
         helper::WriteOnlyAccessor< Data<VecDeriv> > vDest = *this->write(sofa::core::VecDerivId(dest));
         const unsigned int derivDim = sofa::defaulttype::DataTypeInfo<Deriv>::size();
 
-        for (unsigned int i = 0; i < vDest.size(); i++)
-        {
-            for (unsigned int j = 0; j < derivDim; j++)
-            {
-                Real tmp;
-                tmp = (Real)src->element(offset + i * derivDim + j);
-                defaulttype::DataTypeInfo<Deriv>::setValue(vDest[i], j, tmp);
-            }
-        }
+        fromBaseVector<Real, false>(vDest.wref(), 0, vDest.size(), src, offset);
+        markDirty(dest);
 
         offset += vDest.size() * derivDim;
     }
@@ -811,20 +1413,13 @@ void MechanicalObject<DataTypes>::copyFromBaseVector(sofa::core::VecId dest, con
 template <class DataTypes>
 void MechanicalObject<DataTypes>::addToBaseVector(defaulttype::BaseVector* dest, sofa::core::ConstVecId src, unsigned int &offset)
 {
+    NODEPHYSICS_PROBE(m_probes, ProbeAddToBaseVector, 2 * getProbeBytes(src));
     if (src.type == sofa::core::V_COORD)
     {
         helper::ReadAccessor< Data<VecCoord> > vSrc = *this->read(core::ConstVecCoordId(src));
         const unsigned int coordDim = defaulttype::DataTypeInfo<Coord>::size();
 
-        for (unsigned int i = 0; i < vSrc.size(); i++)
-        {
-            for (unsigned int j = 0; j < coordDim; j++)
-            {
-                Real tmp = (Real)0.0;
-                defaulttype::DataTypeInfo<Coord>::getValue(vSrc[i], j, tmp);
-                dest->add(offset + i * coordDim + j, tmp);
-            }
-        }
+        toBaseVector<Real, true>(dest, vSrc.ref(), offset);
 
         offset += vSrc.size() * coordDim;
     }
@@ -833,15 +1428,7 @@ void MechanicalObject<DataTypes>::addToBaseVector(defaulttype::BaseVector* dest,
         helper::ReadAccessor< Data<VecDeriv> > vSrc = *this->read(core::ConstVecDerivId(src));
         const unsigned int derivDim = defaulttype::DataTypeInfo<Deriv>::size();
 
-        for (unsigned int i = 0; i < vSrc.size(); i++)
-        {
-            for (unsigned int j = 0; j < derivDim; j++)
-            {
-                Real tmp;
-                defaulttype::DataTypeInfo<Deriv>::getValue(vSrc[i], j, tmp);
-                dest->add(offset + i * derivDim + j, tmp);
-            }
-        }
+        toBaseVector<Real, true>(dest, vSrc.ref(), offset);
 
         offset += vSrc.size() * derivDim;
     }
@@ -850,20 +1437,14 @@ void MechanicalObject<DataTypes>::addToBaseVector(defaulttype::BaseVector* dest,
 template <class DataTypes>
 void MechanicalObject<DataTypes>::addFromBaseVectorSameSize(sofa::core::VecId dest, const defaulttype::BaseVector *src, unsigned int &offset)
 {
+    NODEPHYSICS_PROBE(m_probes, ProbeAddFromBaseVector, 2 * getProbeBytes(dest));
     if (dest.type == sofa::core::V_COORD)
     {
         helper::WriteAccessor< Data<VecCoord> > vDest = *this->write(core::VecCoordId(dest));
         const unsigned int coordDim = defaulttype::DataTypeInfo<Coord>::size();
 
-        for (unsigned int i = 0; i < vDest.size(); i++)
-        {
-            for (unsigned int j = 0; j < coordDim; j++)
-            {
-                Real tmp = (Real)0.0;
-                defaulttype::DataTypeInfo<Coord>::getValue(vDest[i], j, tmp);
-                defaulttype::DataTypeInfo<Coord>::setValue(vDest[i], j, tmp + src->element(offset + i * coordDim + j));
-            }
-        }
+        fromBaseVector<Real, true>(vDest.wref(), 0, vDest.size(), src, offset);
+        markDirty(dest);
 
         offset += vDest.size() * coordDim;
     }
@@ -872,15 +1453,8 @@ void MechanicalObject<DataTypes>::addFromBaseVectorSameSize(sofa::core::VecId de
         helper::WriteAccessor< Data<VecDeriv> > vDest = *this->write(core::VecDerivId(dest));
         const unsigned int derivDim = defaulttype::DataTypeInfo<Deriv>::size();
 
-        for (unsigned int i = 0; i < vDest.size(); i++)
-        {
-            for (unsigned int j = 0; j < derivDim; j++)
-            {
-                Real tmp = (Real)0.0;
-                defaulttype::DataTypeInfo<Deriv>::getValue(vDest[i], j, tmp);
-                defaulttype::DataTypeInfo<Deriv>::setValue(vDest[i], j, tmp + src->element(offset + i * derivDim + j));
-            }
-        }
+        fromBaseVector<Real, true>(vDest.wref(), 0, vDest.size(), src, offset);
+        markDirty(dest);
 
         offset += vDest.size() * derivDim;
     }
@@ -889,41 +1463,29 @@ void MechanicalObject<DataTypes>::addFromBaseVectorSameSize(sofa::core::VecId de
 template <class DataTypes>
 void MechanicalObject<DataTypes>::addFromBaseVectorDifferentSize(sofa::core::VecId dest, const defaulttype::BaseVector* src, unsigned int &offset )
 {
+    NODEPHYSICS_PROBE(m_probes, ProbeAddFromBaseVector, 2 * src->size() * sizeof(Real));
     if (dest.type == sofa::core::V_COORD)
     {
         helper::WriteAccessor< Data<VecCoord> > vDest = *this->write(core::VecCoordId(dest));
         const unsigned int coordDim = defaulttype::DataTypeInfo<Coord>::size();
         const unsigned int nbEntries = src->size()/coordDim;
-        for (unsigned int i=0; i<nbEntries; i++)
-        {
-            for (unsigned int j=0; j<coordDim; ++j)
-            {
-                Real tmp = (Real)0.0;
-                defaulttype::DataTypeInfo<Coord>::getValue(vDest[i+offset],j,tmp);
-                defaulttype::DataTypeInfo<Coord>::setValue(vDest[i+offset],j, tmp + src->element(i*coordDim+j));
-            }
-        }
+
+        fromBaseVector<Real, true>(vDest.wref(), offset, nbEntries, src, 0);
+        markDirty(dest, offset, offset + nbEntries);
+
         offset += nbEntries;
     }
     else
     {
         helper::WriteAccessor< Data<VecDeriv> > vDest = *this->write(core::VecDerivId(dest));
-
         const unsigned int derivDim = defaulttype::DataTypeInfo<Deriv>::size();
         const unsigned int nbEntries = src->size()/derivDim;
-        for (unsigned int i=0; i<nbEntries; i++)
-        {
-            for (unsigned int j=0; j<derivDim; ++j)
-            {
-                Real tmp = (Real)0.0;
-                defaulttype::DataTypeInfo<Deriv>::getValue(vDest[i+offset],j,tmp);
-                defaulttype::DataTypeInfo<Deriv>::setValue(vDest[i+offset],j, tmp + src->element(i*derivDim+j));
-            }
-        }
-        offset += nbEntries;
-    }
 
+        fromBaseVector<Real, true>(vDest.wref(), offset, nbEntries, src, 0);
+        markDirty(dest, offset, offset + nbEntries);
 
+        offset += nbEntries;
+    }
 }
 
 
@@ -1170,6 +1732,61 @@ void MechanicalObject<DataTypes>::reset()
     if( vfree.isSet() ) vOp(core::ExecParams::defaultInstance(), core::VecId::freeVelocity(), core::VecId::velocity());
 }
 
+template <class DataTypes>
+void MechanicalObject<DataTypes>::cleanup()
+{
+#ifdef NODEPHYSICS_INSTRUMENTATION
+    updateProbeData();
+    const std::string& filename = d_probeFile.getValue();
+    if (!filename.empty() && !instrumentation::appendJSON(filename, this->getPathName(), m_probes))
+        msg_error() << "Cannot write the instrumentation statistics to " << filename;
+#endif
+    Inherited::cleanup();
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::handleEvent(sofa::core::objectmodel::Event* event)
+{
+    if (sofa::simulation::AnimateEndEvent::checkEventType(event))
+        updateProbeData();
+    Inherited::handleEvent(event);
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::updateProbeData()
+{
+    helper::WriteOnlyAccessor< Data< helper::vector<unsigned long> > > calls = d_probeCalls;
+    helper::WriteOnlyAccessor< Data< helper::vector<unsigned long> > > cycles = d_probeCycles;
+    helper::WriteOnlyAccessor< Data< helper::vector<unsigned long> > > bytes = d_probeBytes;
+    m_probes.getValues(calls.wref(), cycles.wref(), bytes.wref());
+}
+
+template <class DataTypes>
+std::size_t MechanicalObject<DataTypes>::getProbeBytes(core::ConstVecId v) const
+{
+    if (v.isNull())
+        return 0;
+    switch (v.type)
+    {
+    case sofa::core::V_COORD: return (std::size_t)d_size.getValue() * sizeof(Coord);
+    case sofa::core::V_DERIV: return (std::size_t)d_size.getValue() * sizeof(Deriv);
+    default: return 0;
+    }
+}
+
+template <class DataTypes>
+std::size_t MechanicalObject<DataTypes>::getProbeBytes(const VMultiOpPlan& plan) const
+{
+    std::size_t bytes = 0;
+    for (const typename VMultiOpPlan::Op& op : plan.ops)
+    {
+        bytes += getProbeBytes(op.dest);
+        for (const core::ConstVecId& term : op.terms)
+            bytes += getProbeBytes(term);
+    }
+    return bytes;
+}
+
 
 template <class DataTypes>
 void MechanicalObject<DataTypes>::writeVec(core::ConstVecId v, std::ostream &out)
@@ -1237,90 +1854,688 @@ void MechanicalObject<DataTypes>::readVec(core::VecId v, std::istream &in)
 }
 
 template <class DataTypes>
-SReal MechanicalObject<DataTypes>::compareVec(core::ConstVecId v, std::istream &in)
+SReal MechanicalObject<DataTypes>::compareVec(core::ConstVecId v, std::istream &in)
+{
+    std::string ref;
+    getline(in, ref);
+
+    if (v.type == sofa::core::V_MATDERIV)
+    {
+        // no flat layout for the matrices, compare their text output
+        std::ostringstream out;
+        out << this->read(core::ConstMatrixDerivId(v))->getValue();
+        const std::string cur = out.str();
+
+        SReal error=0;
+        std::istringstream compare_ref(ref);
+        std::istringstream compare_cur(cur);
+
+        Real value_ref, value_cur;
+        unsigned int count=0;
+        while (compare_ref >> value_ref && compare_cur >> value_cur )
+        {
+            error += fabs(value_ref-value_cur);
+            count ++;
+        }
+        if( count == 0 ) return 0; //both vector are empy, so we return 0;
+
+        return error/count;
+    }
+
+    // parse the reference line directly, up to the first token which is not a number
+    helper::vector<SReal> values;
+    values.reserve(ref.size() / 4);
+    const char* p = ref.c_str();
+    for (;;)
+    {
+        char* end = nullptr;
+        const Real value = parseReal<Real>(p, &end);
+        if (end == p)
+            break;
+        values.push_back((SReal)value);
+        p = end;
+    }
+
+    // the reference was written by writeVec: compare it with the values as writeVec prints them,
+    // so that an unchanged state gives no error
+    VecComparison result;
+    switch (v.type)
+    {
+    case sofa::core::V_COORD:
+        result = compareValues(this->read(core::ConstVecCoordId(v))->getValue(), values.data(), values.size(), true);
+        break;
+    case sofa::core::V_DERIV:
+        result = compareValues(this->read(core::ConstVecDerivId(v))->getValue(), values.data(), values.size(), true);
+        break;
+    default:
+        break;
+    }
+    if (!result.withinTolerance)
+    {
+        msg_warning() << "compareVec: maximal absolute error " << result.maxAbsError
+                      << " above tolerance " << d_compareTolerance.getValue()
+                      << " (mean " << result.meanAbsError << ", L2 " << result.l2Error << ")";
+    }
+    if (result.nbValues == 0) return 0; //both vector are empy, so we return 0;
+
+    return result.meanAbsError;
+}
+
+template <class DataTypes>
+typename MechanicalObject<DataTypes>::VecComparison MechanicalObject<DataTypes>::compareVecValues(core::ConstVecId v, const SReal* ref, std::size_t nbRef)
+{
+    switch (v.type)
+    {
+    case sofa::core::V_COORD:
+        return compareValues(this->read(core::ConstVecCoordId(v))->getValue(), ref, nbRef, false);
+    case sofa::core::V_DERIV:
+        return compareValues(this->read(core::ConstVecDerivId(v))->getValue(), ref, nbRef, false);
+    default:
+        msg_error() << "compareVecValues only applies to coordinate and derivative vectors";
+        return VecComparison();
+    }
+}
+
+template <class DataTypes>
+template <class VecType>
+typename MechanicalObject<DataTypes>::VecComparison MechanicalObject<DataTypes>::compareValues(const VecType& cur, const SReal* ref, std::size_t nbRef, bool printed) const
+{
+    typedef typename VecType::value_type Value;
+    typedef defaulttype::DataTypeInfo<Value> Info;
+    const std::size_t dim = Info::size();
+    const std::size_t n = std::min(nbRef, cur.size() * dim);
+
+    // k-th scalar value of the vector
+    auto value = [&cur, dim](std::size_t k) -> Real
+    {
+        if constexpr (hasScalarLayout<Value, Real>())
+        {
+            SOFA_UNUSED(dim);
+            return reinterpret_cast<const Real*>(cur.data())[k];
+        }
+        else
+        {
+            Real tmp = (Real)0.0;
+            Info::getValue(cur[k / dim], k % dim, tmp);
+            return tmp;
+        }
+    };
+
+    VecComparison result;
+    result.nbValues = (unsigned int)n;
+    result.meanAbsErrors.resize(dim, 0);
+    result.maxAbsErrors.resize(dim, 0);
+    result.l2Errors.resize(dim, 0);
+
+    // one pass over the values, in their order, so that the mean is the sum compareVec always computed
+    SReal sumAbs = 0, sumSquares = 0;
+    helper::vector<SReal> sumSquaresPerComponent(dim, 0);
+    for (std::size_t k = 0, c = 0; k < n; ++k, c = (c + 1 == dim) ? 0 : c + 1)
+    {
+        // printed values are compared in Real, as compareVec read them
+        const SReal d = printed ? (SReal)std::abs(printedValue(value(k)) - (Real)ref[k])
+                                : std::abs((SReal)value(k) - ref[k]);
+        sumAbs += d;
+        sumSquares += d * d;
+        result.meanAbsErrors[c] += d;
+        sumSquaresPerComponent[c] += d * d;
+        if (d > result.maxAbsErrors[c])
+            result.maxAbsErrors[c] = d;
+    }
+
+    for (std::size_t c = 0; c < dim && c < n; ++c)
+    {
+        const std::size_t nc = (n - c + dim - 1) / dim;
+        result.meanAbsErrors[c] /= nc;
+        result.l2Errors[c] = std::sqrt(sumSquaresPerComponent[c]);
+        result.maxAbsError = std::max(result.maxAbsError, result.maxAbsErrors[c]);
+    }
+
+    if (n > 0)
+        result.meanAbsError = sumAbs / n;
+    result.l2Error = std::sqrt(sumSquares);
+
+    const SReal tolerance = d_compareTolerance.getValue();
+    result.withinTolerance = !(tolerance > 0 && result.maxAbsError > tolerance);
+    return result;
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::writeState(std::ostream& out)
+{
+    writeVec(core::VecId::position(),out);
+    out << " ";
+    writeVec(core::VecId::velocity(),out);
+}
+
+template <class DataTypes>
+bool MechanicalObject<DataTypes>::writeCheckpoint(const std::string& filename)
+{
+    checkpoint::Writer out(filename);
+    if (!out.good())
+    {
+        msg_error() << "Cannot open checkpoint file " << filename;
+        return false;
+    }
+
+    const std::string name = DataTypes::Name();
+    out.write(checkpoint::Magic, sizeof(checkpoint::Magic));
+    out.writeValue(checkpoint::Version);
+    out.writeValue(checkpoint::ByteOrderMark);
+    out.writeValue((std::uint32_t)sizeof(Real));
+    out.writeValue((std::uint32_t)sizeof(Coord));
+    out.writeValue((std::uint32_t)sizeof(Deriv));
+    out.writeValue((std::uint32_t)name.size());
+    out.write(name.data(), name.size());
+    out.align();
+    out.writeValue((std::uint64_t)d_size.getValue());
+
+    // the null vectors (index 0) are never saved
+    std::uint32_t nbVectors = 0;
+    for (unsigned int i = 1; i < vectorsCoord.size(); ++i)
+        if (vectorsCoord[i] != nullptr && vectorsCoord[i]->isSet())
+            ++nbVectors;
+    for (unsigned int i = 1; i < vectorsDeriv.size(); ++i)
+        if (vectorsDeriv[i] != nullptr && vectorsDeriv[i]->isSet())
+            ++nbVectors;
+    std::uint32_t nbMatrices = 0;
+    for (unsigned int i = 1; i < vectorsMatrixDeriv.size(); ++i)
+        if (vectorsMatrixDeriv[i] != nullptr)
+            ++nbMatrices;
+    out.writeValue(nbVectors);
+    out.writeValue(nbMatrices);
+
+    // vector: type, index, number of values, values
+    for (unsigned int i = 1; i < vectorsCoord.size(); ++i)
+    {
+        if (vectorsCoord[i] == nullptr || !vectorsCoord[i]->isSet())
+            continue;
+        const VecCoord& vec = vectorsCoord[i]->getValue();
+        out.writeValue((std::uint32_t)sofa::core::V_COORD);
+        out.writeValue((std::uint32_t)i);
+        out.writeValue((std::uint64_t)vec.size());
+        out.write(vec.data(), vec.size() * sizeof(Coord));
+        out.align();
+    }
+    for (unsigned int i = 1; i < vectorsDeriv.size(); ++i)
+    {
+        if (vectorsDeriv[i] == nullptr || !vectorsDeriv[i]->isSet())
+            continue;
+        const VecDeriv& vec = vectorsDeriv[i]->getValue();
+        out.writeValue((std::uint32_t)sofa::core::V_DERIV);
+        out.writeValue((std::uint32_t)i);
+        out.writeValue((std::uint64_t)vec.size());
+        out.write(vec.data(), vec.size() * sizeof(Deriv));
+        out.align();
+    }
+
+    // matrix: index, number of rows, then for each row its index, number of columns, columns and values
+    helper::vector<std::uint32_t> cols;
+    helper::vector<Deriv> values;
+    for (unsigned int i = 1; i < vectorsMatrixDeriv.size(); ++i)
+    {
+        if (vectorsMatrixDeriv[i] == nullptr)
+            continue;
+        const MatrixDeriv& matrix = vectorsMatrixDeriv[i]->getValue();
+        std::uint64_t nbRows = 0;
+        for (MatrixDerivRowConstIterator rowIt = matrix.begin(); rowIt != matrix.end(); ++rowIt)
+            ++nbRows;
+        out.writeValue((std::uint32_t)i);
+        out.writeValue((std::uint32_t)0);
+        out.writeValue(nbRows);
+
+        for (MatrixDerivRowConstIterator rowIt = matrix.begin(); rowIt != matrix.end(); ++rowIt)
+        {
+            cols.clear();
+            values.clear();
+            for (MatrixDerivColConstIterator colIt = rowIt.begin(); colIt != rowIt.end(); ++colIt)
+            {
+                cols.push_back((std::uint32_t)colIt.index());
+                values.push_back(colIt.val());
+            }
+            out.writeValue((std::uint32_t)rowIt.index());
+            out.writeValue((std::uint32_t)cols.size());
+            out.write(cols.data(), cols.size() * sizeof(std::uint32_t));
+            out.align();
+            out.write(values.data(), values.size() * sizeof(Deriv));
+            out.align();
+        }
+    }
+
+    if (!out.close())
+    {
+        msg_error() << "Error while writing checkpoint file " << filename;
+        return false;
+    }
+    return true;
+}
+
+template <class DataTypes>
+bool MechanicalObject<DataTypes>::readCheckpoint(const std::string& filename)
+{
+    checkpoint::Reader in(filename);
+    if (!in.good())
+    {
+        msg_error() << "Cannot open checkpoint file " << filename;
+        return false;
+    }
+
+    char magic[sizeof(checkpoint::Magic)];
+    std::uint32_t version = 0, byteOrder = 0, realSize = 0, coordSize = 0, derivSize = 0, nameLength = 0;
+    in.read(magic, sizeof(magic));
+    in.readValue(version);
+    if (!in.good() || std::memcmp(magic, checkpoint::Magic, sizeof(magic)) != 0)
+    {
+        msg_error() << filename << " is not a checkpoint file";
+        return false;
+    }
+    if (version != checkpoint::Version)
+    {
+        msg_error() << "Unsupported version " << version << " of checkpoint file " << filename;
+        return false;
+    }
+    in.readValue(byteOrder);
+    in.readValue(realSize);
+    in.readValue(coordSize);
+    in.readValue(derivSize);
+    in.readValue(nameLength);
+    const char* name = in.view(nameLength);
+    in.align();
+    if (!in.good())
+    {
+        msg_error() << "Truncated checkpoint file " << filename;
+        return false;
+    }
+    if (byteOrder != checkpoint::ByteOrderMark)
+    {
+        msg_error() << "Checkpoint file " << filename << " was written on a machine with another byte order";
+        return false;
+    }
+    if (std::string(name, nameLength) != DataTypes::Name() || realSize != sizeof(Real)
+            || coordSize != sizeof(Coord) || derivSize != sizeof(Deriv))
+    {
+        msg_error() << "Checkpoint file " << filename << " was written for template " << std::string(name, nameLength);
+        return false;
+    }
+
+    std::uint64_t size = 0;
+    std::uint32_t nbVectors = 0, nbMatrices = 0;
+    in.readValue(size);
+    in.readValue(nbVectors);
+    in.readValue(nbMatrices);
+    if (!in.good())
+    {
+        msg_error() << "Truncated checkpoint file " << filename;
+        return false;
+    }
+    // every saved vector holds size values, which must fit in the rest of the file
+    if (size > in.remaining() / std::min(sizeof(Coord), sizeof(Deriv)))
+    {
+        msg_error() << "Corrupted checkpoint file " << filename << ": invalid size " << size;
+        return false;
+    }
+
+    // read and validate every record before touching the state, so that a bad file leaves it unchanged
+    struct VectorRecord
+    {
+        std::uint32_t type;
+        std::uint32_t index;
+        const char* values;
+    };
+    struct MatrixRow
+    {
+        std::uint32_t row;
+        std::uint32_t nbCols;
+        const char* cols;
+        const char* values;
+    };
+    struct MatrixRecord
+    {
+        std::uint32_t index;
+        std::vector<MatrixRow> rows;
+    };
+
+    std::vector<VectorRecord> vectors;
+    for (std::uint32_t k = 0; k < nbVectors; ++k)
+    {
+        std::uint32_t type = 0, index = 0;
+        std::uint64_t count = 0;
+        in.readValue(type);
+        in.readValue(index);
+        in.readValue(count);
+        const std::size_t valueSize = (type == sofa::core::V_COORD) ? sizeof(Coord) : sizeof(Deriv);
+        if (!in.good() || (type != sofa::core::V_COORD && type != sofa::core::V_DERIV)
+                || index == 0 || index >= checkpoint::MaxVectorIndex
+                || count != size || count > in.remaining() / valueSize)
+        {
+            msg_error() << "Truncated or corrupted checkpoint file " << filename;
+            return false;
+        }
+        const char* values = in.view((std::size_t)count * valueSize);
+        in.align();
+        if (!in.good())
+        {
+            msg_error() << "Truncated checkpoint file " << filename;
+            return false;
+        }
+        vectors.push_back({type, index, values});
+    }
+
+    std::vector<MatrixRecord> matrices;
+    for (std::uint32_t k = 0; k < nbMatrices; ++k)
+    {
+        std::uint32_t index = 0, padding = 0;
+        std::uint64_t nbRows = 0;
+        in.readValue(index);
+        in.readValue(padding);
+        in.readValue(nbRows);
+        // a row takes at least its 8 bytes of header
+        if (!in.good() || index == 0 || index >= checkpoint::MaxVectorIndex || nbRows > in.remaining() / 8)
+        {
+            msg_error() << "Truncated or corrupted checkpoint file " << filename;
+            return false;
+        }
+
+        MatrixRecord matrix;
+        matrix.index = index;
+        matrix.rows.reserve((std::size_t)nbRows);
+        for (std::uint64_t r = 0; r < nbRows; ++r)
+        {
+            MatrixRow row;
+            in.readValue(row.row);
+            in.readValue(row.nbCols);
+            if (!in.good() || row.nbCols > in.remaining() / (sizeof(std::uint32_t) + sizeof(Deriv)))
+            {
+                msg_error() << "Truncated or corrupted checkpoint file " << filename;
+                return false;
+            }
+            row.cols = in.view((std::size_t)row.nbCols * sizeof(std::uint32_t));
+            in.align();
+            row.values = in.view((std::size_t)row.nbCols * sizeof(Deriv));
+            in.align();
+            if (!in.good())
+            {
+                msg_error() << "Truncated checkpoint file " << filename;
+                return false;
+            }
+            for (std::uint32_t c = 0; c < row.nbCols; ++c)
+            {
+                std::uint32_t col;
+                std::memcpy(&col, row.cols + c * sizeof(std::uint32_t), sizeof(std::uint32_t));
+                if (col >= size)
+                {
+                    msg_error() << "Corrupted checkpoint file " << filename << ": invalid column " << col << " in row " << row.row;
+                    return false;
+                }
+            }
+            matrix.rows.push_back(row);
+        }
+        matrices.push_back(std::move(matrix));
+    }
+
+    this->resize((size_t)size);
+
+    // copy by chunks in parallel, so that the pages of the mapped file are loaded concurrently
+    auto copyValues = [this](void* dest, const char* src, std::size_t count, std::size_t valueSize)
+    {
+        char* d = static_cast<char*>(dest);
+        parallelForDofs(count, [=](std::size_t begin, std::size_t end)
+        {
+            std::memcpy(d + begin * valueSize, src + begin * valueSize, (end - begin) * valueSize);
+        });
+    };
+
+    for (const VectorRecord& v : vectors)
+    {
+        if (v.type == sofa::core::V_COORD)
+        {
+            Data<VecCoord>* d = this->write(core::VecCoordId(v.index));
+            VecCoord& vec = *d->beginEdit();
+            vec.resize((size_t)size);
+            copyValues(vec.data(), v.values, vec.size(), sizeof(Coord));
+            d->endEdit();
+        }
+        else
+        {
+            Data<VecDeriv>* d = this->write(core::VecDerivId(v.index));
+            VecDeriv& vec = *d->beginEdit();
+            vec.resize((size_t)size);
+            copyValues(vec.data(), v.values, vec.size(), sizeof(Deriv));
+            d->endEdit();
+        }
+    }
+
+    for (const MatrixRecord& m : matrices)
+    {
+        Data<MatrixDeriv>* d = this->write(core::MatrixDerivId(m.index));
+        MatrixDeriv& matrix = *d->beginEdit();
+        matrix.clear();
+        for (const MatrixRow& row : m.rows)
+        {
+            MatrixDerivRowIterator rowIt = matrix.writeLine(row.row);
+            for (std::uint32_t c = 0; c < row.nbCols; ++c)
+            {
+                std::uint32_t col;
+                Deriv value;
+                std::memcpy(&col, row.cols + c * sizeof(std::uint32_t), sizeof(std::uint32_t));
+                std::memcpy(&value, row.values + c * sizeof(Deriv), sizeof(Deriv));
+                rowIt.addCol(col, value);
+            }
+        }
+        d->endEdit();
+    }
+
+    return true;
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::beginIntegration(SReal /*dt*/)
+{
+    this->forceMask.activate(false);
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::endIntegration(const core::ExecParams* /*params*/ , SReal /*dt*/    )
+{
+    // the DOFs written during this step keep their forces until the next reset
+    for (unsigned int i : m_forceDofs)
+        m_isForceDof[i] = false;
+    m_previousForceDofs.swap(m_forceDofs);
+    m_forceDofs.clear();
+    m_forceDofsValid = m_forceDofsValid && d_sparseForces.getValue();
+
+    this->forceMask.assign( this->getSize(), false );
+    {
+        this->externalForces.beginEdit()->clear();
+        this->externalForces.endEdit();
+    }
+    clearExternalForceDofs();
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::addExternalForce(unsigned int index, const Deriv& force)
+{
+    if (index >= (unsigned int)d_size.getValue())
+    {
+        msg_error() << "addExternalForce: index " << index << " out of range (size " << d_size.getValue() << ")";
+        return;
+    }
+
+    {
+        helper::WriteAccessor< Data<VecDeriv> > extForces = this->externalForces;
+        if (extForces.size() < (std::size_t)d_size.getValue())
+            extForces.resize(d_size.getValue());
+        extForces[index] += force;
+    }
+    markDirty(core::ConstVecDerivId::externalForce(), index, index + 1);
+
+    if (m_isExternalForceDof.size() <= index)
+        m_isExternalForceDof.resize(d_size.getValue(), false);
+    if (!m_isExternalForceDof[index])
+    {
+        m_isExternalForceDof[index] = true;
+        m_externalForceDofs.push_back(index);
+    }
+    m_externalForceCounter = this->externalForces.getCounter();
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::insertForceMaskEntry(unsigned int index)
+{
+    this->forceMask.insertEntry(index);
+
+    if (m_isForceDof.size() <= index)
+        m_isForceDof.resize(std::max<std::size_t>(index + 1, d_size.getValue()), false);
+    if (!m_isForceDof[index])
+    {
+        m_isForceDof[index] = true;
+        m_forceDofs.push_back(index);
+    }
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::getVecState(core::ConstVecId v, int& counter, std::size_t& size)
 {
-    std::string ref,cur;
-    getline(in, ref);
-
-    std::ostringstream out;
-
-    switch (v.type)
+    if (v.type == sofa::core::V_COORD)
     {
-    case sofa::core::V_COORD:
-        out << this->read(core::ConstVecCoordId(v))->getValue();
-        break;
-    case sofa::core::V_DERIV:
-        out << this->read(core::ConstVecDerivId(v))->getValue();
-        break;
-    case sofa::core::V_MATDERIV:
-        out << this->read(core::ConstMatrixDerivId(v))->getValue();
-        break;
-    default:
-        break;
+        const Data<VecCoord>* d = this->read(core::ConstVecCoordId(v));
+        counter = d->getCounter();
+        size = d->getValue().size();
     }
-
-    cur = out.str();
-
-    SReal error=0;
-    std::istringstream compare_ref(ref);
-    std::istringstream compare_cur(cur);
-
-    Real value_ref, value_cur;
-    unsigned int count=0;
-    while (compare_ref >> value_ref && compare_cur >> value_cur )
+    else if (v.type == sofa::core::V_DERIV)
     {
-        error += fabs(value_ref-value_cur);
-        count ++;
+        const Data<VecDeriv>* d = this->read(core::ConstVecDerivId(v));
+        counter = d->getCounter();
+        size = d->getValue().size();
+    }
+    else
+    {
+        counter = -1;
+        size = 0;
     }
-    if( count == 0 ) return 0; //both vector are empy, so we return 0;
-
-    return error/count;
 }
 
 template <class DataTypes>
-void MechanicalObject<DataTypes>::writeState(std::ostream& out)
+void MechanicalObject<DataTypes>::markDirty(core::ConstVecId v, std::size_t begin, std::size_t end)
 {
-    writeVec(core::VecId::position(),out);
-    out << " ";
-    writeVec(core::VecId::velocity(),out);
+    if (!d_trackDirtyRanges.getValue())
+        return;
+
+    int counter;
+    std::size_t size;
+    getVecState(v, counter, size);
+
+    DirtyTracker& tracker = getDirtyTracker(v);
+    // never queried, or edited more than once since the last update: some edits were not recorded
+    if (tracker.counter < 0 || counter > tracker.counter + 1)
+        tracker.ranges.add(0, size);
+    else
+        tracker.ranges.add(begin, std::min(end, size));
+    tracker.counter = counter;
 }
 
 template <class DataTypes>
-void MechanicalObject<DataTypes>::beginIntegration(SReal /*dt*/)
+void MechanicalObject<DataTypes>::markDirty(core::ConstVecId v)
 {
-    this->forceMask.activate(false);
+    markDirty(v, 0, std::numeric_limits<std::size_t>::max());
 }
 
 template <class DataTypes>
-void MechanicalObject<DataTypes>::endIntegration(const core::ExecParams* /*params*/ , SReal /*dt*/    )
+const DirtyRanges& MechanicalObject<DataTypes>::getDirtyRanges(core::ConstVecId v)
 {
-    this->forceMask.assign( this->getSize(), false );
+    int counter;
+    std::size_t size;
+    getVecState(v, counter, size);
+
+    DirtyTracker& tracker = getDirtyTracker(v);
+    if (!d_trackDirtyRanges.getValue())
     {
-        this->externalForces.beginEdit()->clear();
-        this->externalForces.endEdit();
+        tracker.ranges.clear();
+        tracker.ranges.add(0, size);
+    }
+    else if (counter != tracker.counter)
+    {
+        tracker.ranges.add(0, size);
+        tracker.counter = counter;
     }
+    return tracker.ranges;
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::clearDirtyRanges(core::ConstVecId v)
+{
+    int counter;
+    std::size_t size;
+    getVecState(v, counter, size);
+
+    DirtyTracker& tracker = getDirtyTracker(v);
+    tracker.ranges.clear();
+    tracker.counter = counter;
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::clearExternalForceDofs()
+{
+    for (unsigned int i : m_externalForceDofs)
+        m_isExternalForceDof[i] = false;
+    m_externalForceDofs.clear();
+    m_externalForceCounter = this->externalForces.getCounter();
 }
 
 template <class DataTypes>
 void MechanicalObject<DataTypes>::accumulateForce(const core::ExecParams* params, core::VecDerivId fId)
 {
+    NODEPHYSICS_PROBE(m_probes, ProbeAccumulateForce, 2 * getProbeBytes(fId));
 
     {
         helper::ReadAccessor< Data<VecDeriv> > extForces_rA( params, *this->read(core::ConstVecDerivId::externalForce()) );
 
-        if (!extForces_rA.empty())
+        if (extForces_rA.empty())
+            return;
+
+        // sparse mode: only the DOFs given to addExternalForce, unless the external forces were written otherwise
+        if (d_sparseForces.getValue() && this->externalForces.getCounter() == m_externalForceCounter)
         {
             helper::WriteAccessor< Data<VecDeriv> > f_wA ( params, *this->write(fId) );
-
-            for (unsigned int i=0; i < extForces_rA.size(); i++)
+            for (unsigned int i : m_externalForceDofs)
             {
-                if( extForces_rA[i] != Deriv() )
+                if( i < extForces_rA.size() && extForces_rA[i] != Deriv() )
                 {
                     f_wA[i] += extForces_rA[i];
-                    this->forceMask.insertEntry(i); // if an external force is applied on the dofs, it must be added to the mask
+                    insertForceMaskEntry(i); // if an external force is applied on the dofs, it must be added to the mask
                 }
             }
         }
+        else
+        {
+            helper::WriteAccessor< Data<VecDeriv> > f_wA ( params, *this->write(fId) );
+            const VecDeriv& extForces = extForces_rA.ref();
+            VecDeriv& f = f_wA.wref();
+
+            // the mask is not thread-safe: the tasks collect the forced dofs, inserted afterwards
+            std::mutex forcedMutex;
+            helper::vector<unsigned int> forced;
+            parallelForDofs(extForces.size(), [&](std::size_t begin, std::size_t end)
+            {
+                helper::vector<unsigned int> local;
+                for (std::size_t i = begin; i < end; i++)
+                {
+                    if( extForces[i] != Deriv() )
+                    {
+                        f[i] += extForces[i];
+                        local.push_back((unsigned int)i);
+                    }
+                }
+                if (!local.empty())
+                {
+                    std::lock_guard<std::mutex> lock(forcedMutex);
+                    forced.insert(forced.end(), local.begin(), local.end());
+                }
+            });
+
+            for (unsigned int i : forced)
+                insertForceMaskEntry(i); // if an external force is applied on the dofs, it must be added to the mask
+        }
     }
 }
 
@@ -1545,8 +2760,11 @@ void MechanicalObject<DataTypes>::vAlloc(const core::ExecParams* params, core::V
     if (v.index >= sofa::core::VecCoordId::V_FIRST_DYNAMIC_INDEX)
     {
         Data<VecCoord>* vec_d = this->write(v);
-        vec_d->beginEdit(params)->resize(d_size.getValue());
-        vec_d->endEdit(params);
+        if (!allocFromPool(params, *vec_d, m_coordPool))
+        {
+            vec_d->beginEdit(params)->resize(d_size.getValue());
+            vec_d->endEdit(params);
+        }
     }
 
     //vOp(v); // clear vector
@@ -1560,8 +2778,11 @@ void MechanicalObject<DataTypes>::vAlloc(const core::ExecParams* params, core::V
     if (v.index >= sofa::core::VecDerivId::V_FIRST_DYNAMIC_INDEX)
     {
         Data<VecDeriv>* vec_d = this->write(v);
-        vec_d->beginEdit(params)->resize(d_size.getValue());
-        vec_d->endEdit(params);
+        if (!allocFromPool(params, *vec_d, m_derivPool))
+        {
+            vec_d->beginEdit(params)->resize(d_size.getValue());
+            vec_d->endEdit(params);
+        }
     }
 
     //vOp(v); // clear vector
@@ -1598,9 +2819,7 @@ void MechanicalObject<DataTypes>::vFree(const core::ExecParams* params, core::Ve
     {
         Data< VecCoord >* vec_d = this->write(vId);
 
-        VecCoord *vec = vec_d->beginEdit(params);
-        vec->resize(0);
-        vec_d->endEdit(params);
+        releaseToPool(params, *vec_d, m_coordPool);
 
         vec_d->unset(params);
     }
@@ -1613,14 +2832,92 @@ void MechanicalObject<DataTypes>::vFree(const core::ExecParams* params, core::Ve
     {
         Data< VecDeriv >* vec_d = this->write(vId);
 
-        VecDeriv *vec = vec_d->beginEdit(params);
-        vec->resize(0);
-        vec_d->endEdit(params);
+        releaseToPool(params, *vec_d, m_derivPool);
 
         vec_d->unset(params);
     }
 }
 
+template <class DataTypes>
+template <class VecType>
+bool MechanicalObject<DataTypes>::allocFromPool(const core::ExecParams* params, Data<VecType>& d, helper::vector<VecType>& pool)
+{
+    if (pool.empty() || !d_vectorPool.getValue())
+        return false;
+
+    // a vector which already has a buffer keeps it, and its values, as with a plain resize
+    if (d.getValue(params).capacity() > 0)
+        return false;
+
+    const std::size_t n = (std::size_t)d_size.getValue();
+
+    // prefer a buffer of the right size, then one large enough, then the largest one
+    std::size_t best = 0;
+    for (std::size_t i = 0; i < pool.size(); ++i)
+    {
+        if (pool[i].size() == n)
+        {
+            best = i;
+            break;
+        }
+        const bool fits = pool[i].capacity() >= n;
+        const bool bestFits = pool[best].capacity() >= n;
+        if ((fits && (!bestFits || pool[i].capacity() < pool[best].capacity()))
+            || (!fits && !bestFits && pool[i].capacity() > pool[best].capacity()))
+            best = i;
+    }
+
+    VecType& vec = *d.beginEdit(params);
+    vec.swap(pool[best]);
+    pool.erase(pool.begin() + best);
+
+    // the DOFs added by the resize are value-initialized, the ones of the pooled buffer are reset unless told otherwise
+    const std::size_t reused = d_vAllocNoInit.getValue() ? 0 : std::min(vec.size(), n);
+    vec.resize(n);
+    typedef typename VecType::value_type Value;
+    Value* values = vec.data();
+    parallelForDofs(reused, [values](std::size_t begin, std::size_t end)
+    {
+        std::fill(values + begin, values + end, Value());
+    });
+    d.endEdit(params);
+
+    d_vectorPoolHits.setValue(d_vectorPoolHits.getValue() + 1);
+    updateVectorPoolBytes();
+    return true;
+}
+
+template <class DataTypes>
+template <class VecType>
+void MechanicalObject<DataTypes>::releaseToPool(const core::ExecParams* params, Data<VecType>& d, helper::vector<VecType>& pool)
+{
+    VecType *vec = d.beginEdit(params);
+    if (d_vectorPool.getValue() && vec->capacity() > 0 && pool.size() < MaxPoolSize)
+    {
+        pool.push_back(VecType());
+        pool.back().swap(*vec);
+    }
+    else
+    {
+        vec->resize(0);
+    }
+    d.endEdit(params);
+
+    updateVectorPoolBytes();
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::updateVectorPoolBytes()
+{
+    unsigned long bytes = 0;
+    for (const VecCoord& vec : m_coordPool)
+        bytes += (unsigned long)(vec.capacity() * sizeof(Coord));
+    for (const VecDeriv& vec : m_derivPool)
+        bytes += (unsigned long)(vec.capacity() * sizeof(Deriv));
+    if (bytes != d_vectorPoolBytes.getValue())
+        d_vectorPoolBytes.setValue(bytes);
+}
+
 template <class DataTypes>
 void MechanicalObject<DataTypes>::vInit(const core::ExecParams* params
                                         , core::VecCoordId vId
@@ -1654,6 +2951,7 @@ void MechanicalObject<DataTypes>::vOp(const core::ExecParams* params, core::VecI
                                       core::ConstVecId a,
                                       core::ConstVecId b, SReal f)
 {
+    NODEPHYSICS_PROBE(m_probes, ProbeVOp, getProbeBytes(v) + getProbeBytes(a) + getProbeBytes(b));
 
 
     if(v.isNull())
@@ -1662,6 +2960,16 @@ void MechanicalObject<DataTypes>::vOp(const core::ExecParams* params, core::VecI
         msg_error() << "Invalid vOp operation 1 ("<<v<<','<<a<<','<<b<<','<<f<<")";
         return;
     }
+
+    if constexpr (FlatLayout)
+    {
+        if (vOpFlat(params, v, a, b, f))
+        {
+            markDirty(v);
+            return;
+        }
+    }
+
     if (a.isNull())
     {
         if (b.isNull())
@@ -2023,100 +3331,431 @@ void MechanicalObject<DataTypes>::vOp(const core::ExecParams* params, core::VecI
         }
     }
 
+    markDirty(v);
 }
 
 template <class DataTypes>
-void MechanicalObject<DataTypes>::vMultiOp(const core::ExecParams* params, const VMultiOp& ops)
+template <class F>
+void MechanicalObject<DataTypes>::parallelForDofs(std::size_t n, const F& f) const
+{
+    const int grain = d_parallelGrainSize.getValue();
+    nodephysics::parallelFor(0, n, grain > 0 ? (std::size_t)grain : 0, f);
+}
+
+template <class DataTypes>
+bool MechanicalObject<DataTypes>::parallelReductions(std::size_t n) const
 {
-    // optimize common integration case: v += a*dt, x += v*dt
-    if (ops.size() == 2
-            && ops[0].second.size() == 2
-            && ops[0].first.getId(this) == ops[0].second[0].first.getId(this)
-            && ops[0].first.getId(this).type == sofa::core::V_DERIV
-            && ops[0].second[1].first.getId(this).type == sofa::core::V_DERIV
-            && ops[1].second.size() == 2
-            && ops[1].first.getId(this) == ops[1].second[0].first.getId(this)
-            && ops[0].first.getId(this) == ops[1].second[1].first.getId(this)
-            && ops[1].first.getId(this).type == sofa::core::V_COORD)
-    {
-        helper::ReadAccessor< Data<VecDeriv> > va( params, *this->read(core::ConstVecDerivId(ops[0].second[1].first.getId(this))) );
-        helper::WriteAccessor< Data<VecDeriv> > vv( params, *this->write(core::VecDerivId(ops[0].first.getId(this))) );
-        helper::WriteAccessor< Data<VecCoord> > vx( params, *this->write(core::VecCoordId(ops[1].first.getId(this))) );
-
-        const unsigned int n = vx.size();
-        const Real f_v_v = (Real)(ops[0].second[0].second);
-        const Real f_v_a = (Real)(ops[0].second[1].second);
-        const Real f_x_x = (Real)(ops[1].second[0].second);
-        const Real f_x_v = (Real)(ops[1].second[1].second);
-
-        if (f_v_v == 1.0 && f_x_x == 1.0) // very common case
-        {
-            if (f_v_a == 1.0) // used by euler implicit and other integrators that directly computes a*dt
+    const int grain = d_parallelGrainSize.getValue();
+    return grain > 0 && n > (std::size_t)grain && nodephysics::TaskPool::getInstance().getNbThreads() > 1;
+}
+
+template <class DataTypes>
+template <class T>
+bool MechanicalObject<DataTypes>::vOpFlat(const core::ExecParams* params, core::VecId v,
+                                          core::ConstVecId a,
+                                          core::ConstVecId b, SReal f)
+{
+    // same validity rules as the generic implementation, which reports the errors
+    if (v.type != sofa::core::V_COORD && v.type != sofa::core::V_DERIV)
+        return false;
+    if (!a.isNull() && a.type != v.type)
+        return false;
+    if (a.isNull() && !b.isNull() && b.type != v.type)
+        return false;
+    if (v.type == sofa::core::V_DERIV && !b.isNull() && b.type != sofa::core::V_DERIV)
+        return false;
+    if (v.type == sofa::core::V_DERIV && !a.isNull() && a.type != sofa::core::V_DERIV)
+        return false;
+
+    // Coord and Deriv are the same type: both kinds of vectors are handled as VecDeriv
+    auto writeVec = [this](core::VecId id) -> Data<VecDeriv>&
+    {
+        return id.type == sofa::core::V_COORD ? *this->write(core::VecCoordId(id)) : *this->write(core::VecDerivId(id));
+    };
+    auto readVec = [this](core::ConstVecId id) -> const Data<VecDeriv>&
+    {
+        return id.type == sofa::core::V_COORD ? *this->read(core::ConstVecCoordId(id)) : *this->read(core::ConstVecDerivId(id));
+    };
+
+    const std::size_t N = Deriv::total_size;
+    const Real rf = (Real)f;
+
+    // apply kernel(offset, count) on chunks of the n first DOFs, in parallel for large vectors
+    auto forEachChunk = [this, N](std::size_t n, const auto& kernel)
+    {
+        parallelForDofs(n, [&](std::size_t begin, std::size_t end) { kernel(begin * N, (end - begin) * N); });
+    };
+
+    if (a.isNull())
+    {
+        if (b.isNull())
+        {
+            // v = 0
+            helper::WriteOnlyAccessor< Data<VecDeriv> > vv( params, writeVec(v) );
+            vv.resize(d_size.getValue());
+            Real* pv = flatData(vv.wref());
+            forEachChunk(vv.size(), [=](std::size_t o, std::size_t len) { kernels::zero(pv + o, len); });
+        }
+        else if (v == b)
+        {
+            // v *= f
+            helper::WriteAccessor< Data<VecDeriv> > vv( params, writeVec(v) );
+            Real* pv = flatData(vv.wref());
+            forEachChunk(vv.size(), [=](std::size_t o, std::size_t len) { kernels::scale(pv + o, rf, len); });
+        }
+        else
+        {
+            // v = b*f
+            helper::WriteAccessor< Data<VecDeriv> > vv( params, writeVec(v) );
+            helper::ReadAccessor< Data<VecDeriv> > vb( params, readVec(b) );
+            vv.resize(vb.size());
+            Real* pv = flatData(vv.wref());
+            const Real* pb = flatData(vb.ref());
+            forEachChunk(vv.size(), [=](std::size_t o, std::size_t len) { kernels::copyScaled(pv + o, pb + o, rf, len); });
+        }
+    }
+    else if (b.isNull())
+    {
+        // v = a
+        helper::WriteOnlyAccessor< Data<VecDeriv> > vv( params, writeVec(v) );
+        helper::ReadAccessor< Data<VecDeriv> > va( params, readVec(a) );
+        vv.resize(va.size());
+        Real* pv = flatData(vv.wref());
+        const Real* pa = flatData(va.ref());
+        forEachChunk(vv.size(), [=](std::size_t o, std::size_t len) { kernels::copy(pv + o, pa + o, len); });
+    }
+    else if (v == a)
+    {
+        // v += b*f
+        helper::WriteAccessor< Data<VecDeriv> > vv( params, writeVec(v) );
+        helper::ReadAccessor< Data<VecDeriv> > vb( params, readVec(b) );
+        if (vb.size() > vv.size())
+            vv.resize(vb.size());
+        Real* pv = flatData(vv.wref());
+        const Real* pb = flatData(vb.ref());
+        if (f == 1.0)
+            forEachChunk(vb.size(), [=](std::size_t o, std::size_t len) { kernels::add(pv + o, pb + o, len); });
+        else
+            forEachChunk(vb.size(), [=](std::size_t o, std::size_t len) { kernels::addScaled(pv + o, pb + o, rf, len); });
+    }
+    else if (v == b)
+    {
+        if (f == 1.0)
+        {
+            // v += a
+            helper::WriteAccessor< Data<VecDeriv> > vv( params, writeVec(v) );
+            helper::ReadAccessor< Data<VecDeriv> > va( params, readVec(a) );
+            if (va.size() > vv.size())
+                vv.resize(va.size());
+            Real* pv = flatData(vv.wref());
+            const Real* pa = flatData(va.ref());
+            forEachChunk(va.size(), [=](std::size_t o, std::size_t len) { kernels::add(pv + o, pa + o, len); });
+        }
+        else
+        {
+            // v = a+v*f
+            helper::WriteOnlyAccessor< Data<VecDeriv> > vv( params, writeVec(v) );
+            helper::ReadAccessor< Data<VecDeriv> > va( params, readVec(a) );
+            vv.resize(va.size());
+            Real* pv = flatData(vv.wref());
+            const Real* pa = flatData(va.ref());
+            forEachChunk(vv.size(), [=](std::size_t o, std::size_t len) { kernels::scaleAdd(pv + o, pa + o, rf, len); });
+        }
+    }
+    else
+    {
+        // v = a+b*f
+        helper::WriteOnlyAccessor< Data<VecDeriv> > vv( params, writeVec(v) );
+        helper::ReadAccessor< Data<VecDeriv> > va( params, readVec(a) );
+        helper::ReadAccessor< Data<VecDeriv> > vb( params, readVec(b) );
+        vv.resize(va.size());
+        Real* pv = flatData(vv.wref());
+        const Real* pa = flatData(va.ref());
+        const Real* pb = flatData(vb.ref());
+        if (f == 1.0)
+            forEachChunk(vv.size(), [=](std::size_t o, std::size_t len) { kernels::sum(pv + o, pa + o, pb + o, len); });
+        else
+            forEachChunk(vv.size(), [=](std::size_t o, std::size_t len) { kernels::sumScaled(pv + o, pa + o, pb + o, rf, len); });
+    }
+
+    return true;
+}
+
+template <class DataTypes>
+const typename MechanicalObject<DataTypes>::VMultiOpPlan& MechanicalObject<DataTypes>::getVMultiOpPlan(const VMultiOp& ops)
+{
+    // the key only depends on the vectors involved, coefficients are read at each call
+    helper::vector<unsigned int> key;
+    for (unsigned int i = 0; i < ops.size(); ++i)
+    {
+        const core::VecId dest = ops[i].first.getId(this);
+        key.push_back(dest.type);
+        key.push_back(dest.index);
+        key.push_back(ops[i].second.size());
+        for (unsigned int j = 0; j < ops[i].second.size(); ++j)
+        {
+            const core::ConstVecId term = ops[i].second[j].first.getId(this);
+            key.push_back(term.type);
+            key.push_back(term.index);
+        }
+    }
+
+    typename std::map< helper::vector<unsigned int>, VMultiOpPlan >::iterator it = m_vMultiOpPlans.find(key);
+    if (it != m_vMultiOpPlans.end())
+        return it->second;
+
+    VMultiOpPlan& plan = m_vMultiOpPlans[key];
+    plan.fusable = true;
+    plan.ops.resize(ops.size());
+    for (unsigned int i = 0; i < ops.size(); ++i)
+    {
+        typename VMultiOpPlan::Op& op = plan.ops[i];
+        op.dest = ops[i].first.getId(this);
+        for (unsigned int j = 0; j < ops[i].second.size(); ++j)
+            op.terms.push_back(ops[i].second[j].first.getId(this));
+
+        if (op.dest.type != sofa::core::V_COORD && op.dest.type != sofa::core::V_DERIV)
+            plan.fusable = false;
+
+        for (unsigned int j = 0; j < op.terms.size(); ++j)
+        {
+            const core::ConstVecId& term = op.terms[j];
+            if (term.isNull() || (term.type != sofa::core::V_COORD && term.type != sofa::core::V_DERIV))
+                plan.fusable = false;
+            // a Deriv cannot receive Coord terms, a Coord must be initialized from a Coord
+            if (op.dest.type == sofa::core::V_DERIV && term.type != sofa::core::V_DERIV)
+                plan.fusable = false;
+            if (j == 0 && term.type != op.dest.type)
+                plan.fusable = false;
+            // the sequential evaluation reads partially updated values when a later term is the destination itself
+            if (j > 0 && term == op.dest)
+                plan.fusable = false;
+        }
+    }
+
+    return plan;
+}
+
+template <class DataTypes>
+template <class T>
+void MechanicalObject<DataTypes>::vMultiOpFlat(const core::ExecParams* params, const VMultiOpPlan& plan, const VMultiOp& ops)
+{
+    const std::size_t n = (std::size_t)d_size.getValue() * Deriv::total_size;
+
+    // Coord and Deriv are the same type: both kinds of vectors are handled as VecDeriv
+    auto getData = [this](core::ConstVecId id) -> Data<VecDeriv>*
+    {
+        return id.type == sofa::core::V_COORD ? this->write(core::VecCoordId(id)) : this->write(core::VecDerivId(id));
+    };
+
+    // open destinations first, as resizing them would invalidate the pointers to the terms
+    helper::vector< Data<VecDeriv>* > dests(plan.ops.size());
+    helper::vector< Real* > destPtr(plan.ops.size());
+    for (unsigned int i = 0; i < plan.ops.size(); ++i)
+    {
+        dests[i] = getData(plan.ops[i].dest);
+        VecDeriv& vec = *dests[i]->beginEdit(params);
+        if (vec.size() * Deriv::total_size != n)
+            vec.resize(d_size.getValue());
+        destPtr[i] = flatData(vec);
+    }
+
+    helper::vector< helper::vector<const Real*> > termPtr(plan.ops.size());
+    for (unsigned int i = 0; i < plan.ops.size(); ++i)
+    {
+        termPtr[i].resize(plan.ops[i].terms.size());
+        for (unsigned int j = 0; j < plan.ops[i].terms.size(); ++j)
+            termPtr[i][j] = flatData(getData(plan.ops[i].terms[j])->getValue(params));
+    }
+
+    // blocks small enough for all the vectors involved to stay in cache between two operations,
+    // the DOFs being shared among the threads for large vectors
+    const std::size_t blockSize = 2048;
+    parallelForDofs(d_size.getValue(), [&](std::size_t beginDof, std::size_t endDof)
+    {
+        const std::size_t end = endDof * Deriv::total_size;
+        for (std::size_t start = beginDof * Deriv::total_size; start < end; start += blockSize)
+        {
+            const std::size_t len = std::min(blockSize, end - start);
+            for (unsigned int i = 0; i < plan.ops.size(); ++i)
             {
-                for (unsigned int i=0; i<n; ++i)
+                Real* d = destPtr[i] + start;
+                const helper::vector<const Real*>& terms = termPtr[i];
+                if (terms.empty())
                 {
-                    vv[i] += va[i];
-                    vx[i] += vv[i]*f_x_v;
+                    kernels::zero(d, len);
+                    continue;
                 }
-            }
-            else
-            {
-                for (unsigned int i=0; i<n; ++i)
+
+                const Real f0 = (Real)ops[i].second[0].second;
+                if (terms[0] == destPtr[i])
+                {
+                    if (f0 != 1.0)
+                        kernels::scale(d, f0, len);
+                }
+                else if (f0 == 1.0)
+                    kernels::copy(d, terms[0] + start, len);
+                else
+                    kernels::copyScaled(d, terms[0] + start, f0, len);
+
+                for (unsigned int j = 1; j < terms.size(); ++j)
                 {
-                    vv[i] += va[i]*f_v_a;
-                    vx[i] += vv[i]*f_x_v;
+                    const Real fj = (Real)ops[i].second[j].second;
+                    if (fj == 1.0)
+                        kernels::add(d, terms[j] + start, len);
+                    else
+                        kernels::addScaled(d, terms[j] + start, fj, len);
                 }
             }
         }
-        else if (f_x_x == 1.0) // some damping is applied to v
+    });
+
+    for (unsigned int i = 0; i < dests.size(); ++i)
+        dests[i]->endEdit(params);
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::vMultiOpTyped(const core::ExecParams* params, const VMultiOpPlan& plan, const VMultiOp& ops)
+{
+    const std::size_t n = (std::size_t)d_size.getValue();
+    const std::size_t nbOps = plan.ops.size();
+
+    // open destinations first, as resizing them would invalidate the pointers to the terms
+    helper::vector< Coord* > destCoord(nbOps, nullptr);
+    helper::vector< Deriv* > destDeriv(nbOps, nullptr);
+    for (unsigned int i = 0; i < nbOps; ++i)
+    {
+        const core::VecId& dest = plan.ops[i].dest;
+        if (dest.type == sofa::core::V_COORD)
+        {
+            VecCoord& vec = *this->write(core::VecCoordId(dest))->beginEdit(params);
+            if (vec.size() != n)
+                vec.resize(n);
+            destCoord[i] = vec.data();
+        }
+        else
         {
-            for (unsigned int i=0; i<n; ++i)
-            {
-                vv[i] *= f_v_v;
-                vv[i] += va[i];
-                vx[i] += vv[i]*f_x_v;
-            }
+            VecDeriv& vec = *this->write(core::VecDerivId(dest))->beginEdit(params);
+            if (vec.size() != n)
+                vec.resize(n);
+            destDeriv[i] = vec.data();
+        }
+    }
+
+    helper::vector< helper::vector<const Coord*> > termCoord(nbOps);
+    helper::vector< helper::vector<const Deriv*> > termDeriv(nbOps);
+    helper::vector< helper::vector<Real> > coefs(nbOps);
+    for (unsigned int i = 0; i < nbOps; ++i)
+    {
+        const helper::vector<core::ConstVecId>& terms = plan.ops[i].terms;
+        termCoord[i].resize(terms.size(), nullptr);
+        termDeriv[i].resize(terms.size(), nullptr);
+        coefs[i].resize(terms.size());
+        for (unsigned int j = 0; j < terms.size(); ++j)
+        {
+            if (terms[j].type == sofa::core::V_COORD)
+                termCoord[i][j] = this->read(core::ConstVecCoordId(terms[j]))->getValue(params).data();
+            else
+                termDeriv[i][j] = this->read(core::ConstVecDerivId(terms[j]))->getValue(params).data();
+            coefs[i][j] = (Real)ops[i].second[j].second;
         }
-        else // general case
+    }
+
+    parallelForDofs(n, [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t k = begin; k < end; ++k)
         {
-            for (unsigned int i=0; i<n; ++i)
+            for (unsigned int i = 0; i < nbOps; ++i)
             {
-                vv[i] *= f_v_v;
-                vv[i] += va[i]*f_v_a;
-                vx[i] *= f_x_x;
-                vx[i] += vv[i]*f_x_v;
+                const helper::vector<Real>& f = coefs[i];
+                if (destCoord[i])
+                {
+                    Coord& r = destCoord[i][k];
+                    if (f.empty())
+                    {
+                        r = Coord();
+                        continue;
+                    }
+                    if (f[0] == 1.0) r = termCoord[i][0][k];
+                    else r = termCoord[i][0][k] * f[0];
+                    for (unsigned int j = 1; j < f.size(); ++j)
+                    {
+                        if (termCoord[i][j])
+                        {
+                            if (f[j] == 1.0) r += termCoord[i][j][k];
+                            else r += termCoord[i][j][k] * f[j];
+                        }
+                        else
+                        {
+                            if (f[j] == 1.0) r += termDeriv[i][j][k];
+                            else r += termDeriv[i][j][k] * f[j];
+                        }
+                    }
+                }
+                else
+                {
+                    Deriv& r = destDeriv[i][k];
+                    if (f.empty())
+                    {
+                        r = Deriv();
+                        continue;
+                    }
+                    if (f[0] == 1.0) r = termDeriv[i][0][k];
+                    else r = termDeriv[i][0][k] * f[0];
+                    for (unsigned int j = 1; j < f.size(); ++j)
+                    {
+                        if (f[j] == 1.0) r += termDeriv[i][j][k];
+                        else r += termDeriv[i][j][k] * f[j];
+                    }
+                }
             }
         }
-    }
-    else if(ops.size()==2 //used in the ExplicitBDF solver only (Electrophysiology)
-            && ops[0].second.size()==1
-            && ops[0].second[0].second == 1.0
-            && ops[1].second.size()==3
-            )
-    {
-        helper::ReadAccessor< Data<VecCoord> > v11( params, *this->read(core::ConstVecCoordId(ops[0].second[0].first.getId(this))) );
-        helper::ReadAccessor< Data<VecCoord> > v21( params, *this->read(core::ConstVecCoordId(ops[1].second[0].first.getId(this))) );
-        helper::ReadAccessor< Data<VecCoord> > v22( params, *this->read(core::ConstVecCoordId(ops[1].second[1].first.getId(this))) );
-        helper::ReadAccessor< Data<VecDeriv> > v23( params, *this->read(core::ConstVecDerivId(ops[1].second[2].first.getId(this))) );
+    });
 
-        helper::WriteAccessor< Data<VecCoord> > previousPos( params, *this->write(core::VecCoordId(ops[0].first.getId(this))) );
-        helper::WriteAccessor< Data<VecCoord> > newPos( params, *this->write(core::VecCoordId(ops[1].first.getId(this))) );
+    for (unsigned int i = 0; i < nbOps; ++i)
+    {
+        const core::VecId& dest = plan.ops[i].dest;
+        if (dest.type == sofa::core::V_COORD)
+            this->write(core::VecCoordId(dest))->endEdit(params);
+        else
+            this->write(core::VecDerivId(dest))->endEdit(params);
+    }
+}
 
-        const unsigned int n = v11.size();
-        const Real f_1 = (Real)(ops[1].second[0].second);
-        const Real f_2 = (Real)(ops[1].second[1].second);
-        const Real f_3 = (Real)(ops[1].second[2].second);
+template <class DataTypes>
+void MechanicalObject<DataTypes>::vMultiOp(const core::ExecParams* params, const VMultiOp& ops)
+{
+    const VMultiOpPlan& plan = getVMultiOpPlan(ops);
+    NODEPHYSICS_PROBE(m_probes, ProbeVMultiOp, getProbeBytes(plan));
 
-        for (unsigned int i=0; i<n; ++i)
+    // all terms must have the size of the state, as in a single vOp
+    bool sizesMatch = plan.fusable;
+    const std::size_t n = (std::size_t)d_size.getValue();
+    for (unsigned int i = 0; sizesMatch && i < plan.ops.size(); ++i)
+    {
+        for (unsigned int j = 0; sizesMatch && j < plan.ops[i].terms.size(); ++j)
         {
-            previousPos[i] = v11[i];
-            newPos[i]  = v21[i]*f_1;
-            newPos[i] += v22[i]*f_2;
-            newPos[i] += v23[i]*f_3;
+            const core::ConstVecId& term = plan.ops[i].terms[j];
+            const std::size_t size = term.type == sofa::core::V_COORD
+                    ? this->read(core::ConstVecCoordId(term))->getValue(params).size()
+                    : this->read(core::ConstVecDerivId(term))->getValue(params).size();
+            sizesMatch = (size == n);
         }
     }
-    else // no optimization for now for other cases
+
+    if (!sizesMatch)
+    {
         Inherited::vMultiOp(params, ops);
+        return;
+    }
+
+    if constexpr (FlatLayout)
+        vMultiOpFlat(params, plan, ops);
+    else
+        vMultiOpTyped(params, plan, ops);
+
+    for (const VMultiOpPlan::Op& op : plan.ops)
+        markDirty(op.dest);
 }
 
 template <class T> inline void clear( T& t )
@@ -2140,12 +3779,16 @@ void MechanicalObject<DataTypes>::vThreshold(core::VecId v, SReal t)
     if( v.type==sofa::core::V_DERIV)
     {
         helper::WriteAccessor< Data<VecDeriv> > vv = *this->write(core::VecDerivId(v));
+        VecDeriv& vec = vv.wref();
         Real t2 = (Real)(t*t);
-        for (unsigned int i=0; i<vv.size(); i++)
+        parallelForDofs(vec.size(), [&](std::size_t begin, std::size_t end)
         {
-            if( vv[i]*vv[i] < t2 )
-                clear(vv[i]);
-        }
+            for (std::size_t i = begin; i < end; i++)
+            {
+                if( vec[i]*vec[i] < t2 )
+                    clear(vec[i]);
+            }
+        });
     }
     else
     {
@@ -2156,27 +3799,81 @@ void MechanicalObject<DataTypes>::vThreshold(core::VecId v, SReal t)
 template <class DataTypes>
 SReal MechanicalObject<DataTypes>::vDot(const core::ExecParams* params, core::ConstVecId a, core::ConstVecId b)
 {
-    Real r = 0.0;
+    NODEPHYSICS_PROBE(m_probes, ProbeVDot, getProbeBytes(a) + getProbeBytes(b));
+    const bool deterministic = d_deterministicReductions.getValue();
+    SReal r = 0.0;
 
     if (a.type == sofa::core::V_COORD && b.type == sofa::core::V_COORD)
     {
         const VecCoord &va = this->read(core::ConstVecCoordId(a))->getValue(params);
         const VecCoord &vb = this->read(core::ConstVecCoordId(b))->getValue(params);
+        const bool parallel = parallelReductions(va.size());
 
-        for (unsigned int i=0; i<va.size(); i++)
+        if (!deterministic && !parallel)
+        {
+            Real s = 0.0;
+            for (unsigned int i=0; i<va.size(); i++)
+            {
+                s += va[i] * vb[i];
+            }
+            r = s;
+        }
+        else if constexpr (FlatLayout)
         {
-            r += va[i] * vb[i];
+            const Real* pa = flatData(va);
+            const Real* pb = flatData(vb);
+            r = reduction::sum(va.size() * Coord::total_size, deterministic, parallel, [pa, pb](std::size_t i) { return (double)pa[i] * (double)pb[i]; });
         }
+        else
+            r = reduction::sum(va.size(), deterministic, parallel, [&va, &vb](std::size_t i)
+            {
+                if constexpr (std::is_same<Real, double>::value)
+                    return (double)(va[i] * vb[i]);
+                else
+                {
+                    // float storage: accumulate the products in double
+                    double d = 0.0;
+                    for (unsigned j = 0; j < DataTypes::coord_total_size; j++)
+                        d += (double)va[i][j] * (double)vb[i][j];
+                    return d;
+                }
+            });
     }
     else if (a.type == sofa::core::V_DERIV && b.type == sofa::core::V_DERIV)
     {
         const VecDeriv &va = this->read(core::ConstVecDerivId(a))->getValue(params);
         const VecDeriv &vb = this->read(core::ConstVecDerivId(b))->getValue(params);
+        const bool parallel = parallelReductions(va.size());
 
-        for (unsigned int i=0; i<va.size(); i++)
+        if (!deterministic && !parallel)
+        {
+            Real s = 0.0;
+            for (unsigned int i=0; i<va.size(); i++)
+            {
+                s += va[i] * vb[i];
+            }
+            r = s;
+        }
+        else if constexpr (FlatLayout)
         {
-            r += va[i] * vb[i];
+            const Real* pa = flatData(va);
+            const Real* pb = flatData(vb);
+            r = reduction::sum(va.size() * Deriv::total_size, deterministic, parallel, [pa, pb](std::size_t i) { return (double)pa[i] * (double)pb[i]; });
         }
+        else
+            r = reduction::sum(va.size(), deterministic, parallel, [&va, &vb](std::size_t i)
+            {
+                if constexpr (std::is_same<Real, double>::value)
+                    return (double)(va[i] * vb[i]);
+                else
+                {
+                    // float storage: accumulate the products in double
+                    double d = 0.0;
+                    for (unsigned j = 0; j < DataTypes::deriv_total_size; j++)
+                        d += (double)va[i][j] * (double)vb[i][j];
+                    return d;
+                }
+            });
     }
     else
     {
@@ -2191,7 +3888,7 @@ typedef std::size_t nat;
 template <class DataTypes>
 SReal MechanicalObject<DataTypes>::vSum(const core::ExecParams* params, core::ConstVecId a, unsigned l)
 {
-    Real r = 0.0;
+    SReal r = 0.0;
 
     if (a.type == sofa::core::V_COORD )
     {
@@ -2200,16 +3897,38 @@ SReal MechanicalObject<DataTypes>::vSum(const core::ExecParams* params, core::Co
     else if (a.type == sofa::core::V_DERIV)
     {
         const VecDeriv &va = this->read(core::ConstVecDerivId(a))->getValue(params);
+        const bool deterministic = d_deterministicReductions.getValue();
+        const bool parallel = parallelReductions(va.size());
 
-        if( l==0 ) for (nat i=0; i<va.size(); i++)
+        if( l==0 )
         {
-            for(unsigned j=0; j<DataTypes::deriv_total_size; j++)
-                if ( fabs(va[i][j])>r) r=fabs(va[i][j]);
+            r = reduction::max(va.size(), 0.0, parallel, [&va](nat i)
+            {
+                double m = 0.0;
+                for(unsigned j=0; j<DataTypes::deriv_total_size; j++)
+                    if ( fabs(va[i][j])>m) m=fabs(va[i][j]);
+                return m;
+            });
         }
-        else for (unsigned int i=0; i<va.size(); i++)
+        else if (!deterministic && !parallel)
         {
-            for(unsigned j=0; j<DataTypes::deriv_total_size; j++)
-                r += (Real) exp(va[i][j]/l);
+            Real s = 0.0;
+            for (unsigned int i=0; i<va.size(); i++)
+            {
+                for(unsigned j=0; j<DataTypes::deriv_total_size; j++)
+                    s += (Real) exp(va[i][j]/l);
+            }
+            r = s;
+        }
+        else
+        {
+            r = reduction::sum(va.size(), deterministic, parallel, [&va, l](nat i)
+            {
+                double s = 0.0;
+                for(unsigned j=0; j<DataTypes::deriv_total_size; j++)
+                    s += exp((double)va[i][j]/l);
+                return s;
+            });
         }
     }
     else
@@ -2223,27 +3942,31 @@ SReal MechanicalObject<DataTypes>::vSum(const core::ExecParams* params, core::Co
 template <class DataTypes>
 SReal MechanicalObject<DataTypes>::vMax(const core::ExecParams* params, core::ConstVecId a )
 {
-    Real r = 0.0;
+    SReal r = 0.0;
 
     if (a.type == sofa::core::V_COORD )
     {
         const VecCoord &va = this->read(core::ConstVecCoordId(a))->getValue(params);
 
-        for (nat i=0; i<va.size(); i++)
+        r = reduction::max(va.size(), 0.0, parallelReductions(va.size()), [&va](nat i)
         {
+            double m = 0.0;
             for(unsigned j=0; j<DataTypes::coord_total_size; j++)
-                if (fabs(va[i][j])>r) r=fabs(va[i][j]);
-        }
+                if (fabs(va[i][j])>m) m=fabs(va[i][j]);
+            return m;
+        });
     }
     else if (a.type == sofa::core::V_DERIV)
     {
         const VecDeriv &va = this->read(core::ConstVecDerivId(a))->getValue(params);
 
-        for (nat i=0; i<va.size(); i++)
+        r = reduction::max(va.size(), 0.0, parallelReductions(va.size()), [&va](nat i)
         {
+            double m = 0.0;
             for(unsigned j=0; j<DataTypes::deriv_total_size; j++)
-                if (fabs(va[i][j])>r) r=fabs(va[i][j]);
-        }
+                if (fabs(va[i][j])>m) m=fabs(va[i][j]);
+            return m;
+        });
     }
     else
     {
@@ -2359,11 +4082,36 @@ unsigned MechanicalObject<DataTypes>::printDOFWithElapsedTime(core::ConstVecId v
 template <class DataTypes>
 void MechanicalObject<DataTypes>::resetForce(const core::ExecParams* params, core::VecDerivId fid)
 {
+    NODEPHYSICS_PROBE(m_probes, ProbeResetForce, getProbeBytes(fid));
     {
-        helper::WriteOnlyAccessor< Data<VecDeriv> > f( params, *this->write(fid) );
-        for (unsigned i = 0; i < f.size(); ++i)
-//          if( this->forceMask.getEntry(i) ) // safe getter or not?
+        helper::WriteOnlyAccessor< Data<VecDeriv> > f_wA( params, *this->write(fid) );
+        VecDeriv& f = f_wA.wref();
+
+        // sparse mode: the non-zero forces can only be on the DOFs declared during the last step or since then
+        if (d_sparseForces.getValue() && fid == core::VecDerivId::force() && m_forceDofsValid
+                && this->forceMask.isActivated())
+        {
+            for (unsigned int i : m_previousForceDofs)
+                if (i < f.size())
+                    f[i] = Deriv();
+            m_previousForceDofs.clear();
+            for (unsigned int i : m_forceDofs)
+                if (i < f.size())
+                    f[i] = Deriv();
+            return;
+        }
+
+        parallelForDofs(f.size(), [&](std::size_t begin, std::size_t end)
+        {
+            for (std::size_t i = begin; i < end; ++i)
                 f[i] = Deriv();
+        });
+        if (fid == core::VecDerivId::force())
+        {
+            // all zero: from now on only the declared DOFs can hold forces
+            m_previousForceDofs.clear();
+            m_forceDofsValid = d_sparseForces.getValue();
+        }
     }
 }
 
@@ -2371,11 +4119,15 @@ template <class DataTypes>
 void MechanicalObject<DataTypes>::resetAcc(const core::ExecParams* params, core::VecDerivId aId)
 {
     {
-        helper::WriteOnlyAccessor< Data<VecDeriv> > a( params, *this->write(aId) );
-        for (unsigned i = 0; i < a.size(); ++i)
+        helper::WriteOnlyAccessor< Data<VecDeriv> > a_wA( params, *this->write(aId) );
+        VecDeriv& a = a_wA.wref();
+        parallelForDofs(a.size(), [&](std::size_t begin, std::size_t end)
         {
-            a[i] = Deriv();
-        }
+            for (std::size_t i = begin; i < end; ++i)
+            {
+                a[i] = Deriv();
+            }
+        });
     }
 }
 
@@ -2401,6 +4153,45 @@ void MechanicalObject<DataTypes>::getConstraintJacobian(const core::ConstraintPa
 
     MatrixDerivRowConstIterator rowItEnd = c.end();
 
+    // dense matrix: add the rows in place rather than through the virtual add. Only for the exact
+    // type, since a derived matrix may override add; the blocks outside of the matrix go through add.
+    typedef sofa::component::linearsolver::FullMatrix<SReal> FullMatrix;
+    if (typeid(*J) == typeid(FullMatrix))
+    {
+        FullMatrix* full = static_cast<FullMatrix*>(J);
+        const std::size_t nbCols = (std::size_t)full->colSize();
+
+        for (MatrixDerivRowConstIterator rowIt = c.begin(); rowIt != rowItEnd; ++rowIt)
+        {
+            const int cid = rowIt.index();
+            SReal* row = (cid >= 0 && cid < (int)full->rowSize()) ? (*full)[cid] : nullptr;
+
+            MatrixDerivColConstIterator colItEnd = rowIt.end();
+
+            for (MatrixDerivColConstIterator colIt = rowIt.begin(); colIt != colItEnd; ++colIt) {
+                const unsigned int dof = colIt.index();
+                const Deriv& n = colIt.val();
+
+                if (row != nullptr && off + (std::size_t)dof * N + N <= nbCols)
+                {
+                    SReal* block = row + off + dof * N;
+                    for (unsigned int r = 0; r < N; ++r) {
+                        block[r] += n[r];
+                    }
+                }
+                else
+                {
+                    for (unsigned int r = 0; r < N; ++r) {
+                        J->add(cid, off + dof * N + r, n[r]);
+                    }
+                }
+            }
+        }
+
+        off += this->getSize() * N;
+        return;
+    }
+
     for (MatrixDerivRowConstIterator rowIt = c.begin(); rowIt != rowItEnd; ++rowIt)
     {
         const int cid = rowIt.index();
@@ -2420,6 +4211,50 @@ void MechanicalObject<DataTypes>::getConstraintJacobian(const core::ConstraintPa
     off += this->getSize() * N;
 }
 
+template <class DataTypes>
+void MechanicalObject<DataTypes>::getConstraintJacobian(const core::ConstraintParams* cParams, ConstraintJacobianCSR& J, unsigned int off) const
+{
+    const size_t N = Deriv::size();
+    const MatrixDeriv& c = cParams->readJ(this)->getValue(cParams);
+
+    MatrixDerivRowConstIterator rowItEnd = c.end();
+
+    // count the entries first, to fill the arrays without reallocation
+    std::size_t nbRows = 0, nbBlocks = 0;
+    for (MatrixDerivRowConstIterator rowIt = c.begin(); rowIt != rowItEnd; ++rowIt)
+    {
+        ++nbRows;
+        MatrixDerivColConstIterator colItEnd = rowIt.end();
+        for (MatrixDerivColConstIterator colIt = rowIt.begin(); colIt != colItEnd; ++colIt)
+            ++nbBlocks;
+    }
+
+    J.clear();
+    J.rowIndices.reserve(nbRows);
+    J.rowBegin.reserve(nbRows + 1);
+    J.colIndices.reserve(nbBlocks * N);
+    J.values.reserve(nbBlocks * N);
+
+    for (MatrixDerivRowConstIterator rowIt = c.begin(); rowIt != rowItEnd; ++rowIt)
+    {
+        J.rowIndices.push_back(rowIt.index());
+        J.rowBegin.push_back((int)J.colIndices.size());
+
+        MatrixDerivColConstIterator colItEnd = rowIt.end();
+
+        for (MatrixDerivColConstIterator colIt = rowIt.begin(); colIt != colItEnd; ++colIt) {
+            const unsigned int dof = colIt.index();
+            const Deriv& n = colIt.val();
+
+            for (unsigned int r = 0; r < N; ++r) {
+                J.colIndices.push_back((int)(off + dof * N + r));
+                J.values.push_back(n[r]);
+            }
+        }
+    }
+    J.rowBegin.push_back((int)J.colIndices.size());
+}
+
 template <class DataTypes>
 void MechanicalObject<DataTypes>::buildIdentityBlocksInJacobian(const sofa::helper::vector<unsigned int>& list_n, core::MatrixDerivId &mID)
 {
@@ -2454,63 +4289,73 @@ std::list< core::behavior::BaseMechanicalState::ConstraintBlock > MechanicalObje
     assert( indices.size() > 0 );
     assert( dimensionDeriv > 0 );
 
-    // simple column/block map
-
     typedef sofa::component::linearsolver::SparseMatrix<SReal> matrix_t;
     // typedef sofa::component::linearsolver::FullMatrix<SReal> matrix_t;
 
-    typedef std::map<unsigned int, matrix_t* > blocks_t;
-    blocks_t blocks;
+    ConstraintBlocks blocks;
+    getConstraintBlocks(helper::vector<unsigned int>(indices.begin(), indices.end()), blocks);
 
-    // for all row indices
-    typedef std::list<unsigned int> indices_t;
-
-    const MatrixDeriv& constraints = c.getValue();
-
-    unsigned int block_row = 0;
-    for (indices_t::const_iterator rowIt = indices.begin(); rowIt != indices.end(); ++rowIt, ++block_row)
+    // one matrix per block, as expected by the callers
+    std::list<ConstraintBlock> res;
+    for (std::size_t b = 0; b < blocks.columns.size(); ++b)
     {
-        MatrixDerivRowConstIterator rowIterator = constraints.readLine(*rowIt);
-
-        if (rowIterator != constraints.end())
+        matrix_t* mat = new matrix_t(indices.size(), dimensionDeriv);
+        for (unsigned int e = blocks.blockBegin[b]; e < blocks.blockBegin[b + 1]; ++e)
         {
-            MatrixDerivColConstIterator chunk = rowIterator.begin();
-            MatrixDerivColConstIterator chunkEnd = rowIterator.end();
+            for (unsigned int i = 0; i < dimensionDeriv; ++i)
+                mat->set(blocks.lines[e], i, blocks.values[e * dimensionDeriv + i]);
+        }
+        res.push_back( ConstraintBlock( blocks.columns[b], mat ) );
+    }
 
-            for( ; chunk != chunkEnd ; chunk++)
-            {
-                const unsigned int column = chunk.index();
-                if( blocks.find( column ) == blocks.end() )
-                {
-                    // nope: let's create it
-                    matrix_t* mat = new matrix_t(indices.size(), dimensionDeriv);
-                    blocks[column] = mat;
-                }
+    return res;
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::getConstraintBlocks( const helper::vector<unsigned int>& indices, ConstraintBlocks& blocks ) const
+{
+    const unsigned int dimensionDeriv = defaulttype::DataTypeInfo< Deriv >::size();
+    const MatrixDeriv& constraints = c.getValue();
 
-                // now it's created no matter what \o/
-                matrix_t& block = *blocks[column];
+    blocks.clear();
+    blocks.nbLines = (unsigned int)indices.size();
+    blocks.blockSize = dimensionDeriv;
 
-                // fill the right line of the block
-                const Deriv curValue = chunk.val();
+    for (unsigned int line = 0; line < indices.size(); ++line)
+    {
+        MatrixDerivRowConstIterator rowIterator = constraints.readLine(indices[line]);
+        if (rowIterator == constraints.end())
+            continue;
 
-                for (unsigned int i = 0; i < dimensionDeriv; ++i)
-                {
-                    SReal value;
-                    defaulttype::DataTypeInfo< Deriv >::getValue(curValue, i, value);
-                    block.set(block_row, i, value);
-                }
-            }
-        }
+        MatrixDerivColConstIterator chunkEnd = rowIterator.end();
+        for (MatrixDerivColConstIterator chunk = rowIterator.begin(); chunk != chunkEnd; ++chunk)
+            blocks.entries.push_back({ chunk.index(), line, &chunk.val() });
     }
 
-    // put all blocks in a list and we're done
-    std::list<ConstraintBlock> res;
-    for(blocks_t::const_iterator b = blocks.begin(); b != blocks.end(); ++b)
+    // group the entries by column, keeping the line order in each block
+    std::sort(blocks.entries.begin(), blocks.entries.end());
+
+    const std::size_t nbEntries = blocks.entries.size();
+    blocks.lines.resize(nbEntries);
+    blocks.values.resize(nbEntries * dimensionDeriv);
+    for (std::size_t e = 0; e < nbEntries; ++e)
     {
-        res.push_back( ConstraintBlock( b->first, b->second ) );
+        const typename ConstraintBlocks::Entry& entry = blocks.entries[e];
+        if (blocks.columns.empty() || blocks.columns.back() != entry.column)
+        {
+            blocks.columns.push_back(entry.column);
+            blocks.blockBegin.push_back((unsigned int)e);
+        }
+        blocks.lines[e] = entry.line;
+        for (unsigned int i = 0; i < dimensionDeriv; ++i)
+        {
+            SReal value;
+            defaulttype::DataTypeInfo< Deriv >::getValue(*entry.value, i, value);
+            blocks.values[e * dimensionDeriv + i] = value;
+        }
     }
-
-    return res;
+    blocks.blockBegin.push_back((unsigned int)nbEntries);
+    blocks.entries.clear();
 }
 
 template <class DataTypes>
@@ -2527,14 +4372,9 @@ SReal MechanicalObject<DataTypes>::getConstraintJacobianTimesVecDeriv(unsigned i
 
     const VecDeriv *data = 0;
 
-    // Maybe we should extend this to restvelocity
-    if (id == core::ConstVecId::velocity())
-    {
-        data = &v.getValue();
-    }
-    else if (id == core::ConstVecId::dx())
+    if (id.type == sofa::core::V_DERIV && read(core::ConstVecDerivId(id)) != nullptr)
     {
-        data = &dx.getValue();
+        data = &read(core::ConstVecDerivId(id))->getValue();
     }
     else
     {
@@ -2554,6 +4394,105 @@ SReal MechanicalObject<DataTypes>::getConstraintJacobianTimesVecDeriv(unsigned i
     return result;
 }
 
+template <class DataTypes>
+void MechanicalObject<DataTypes>::getConstraintJacobianTimesVecDeriv(core::ConstVecDerivId w, helper::vector<unsigned int>& lines, helper::vector<SReal>& result)
+{
+    lines.clear();
+    result.clear();
+
+    const Data<VecDeriv>* d = read(w);
+    if (d == nullptr)
+    {
+        msg_error() << "getConstraintJacobianTimesVecDeriv " << "NOT IMPLEMENTED for " << w.getName();
+        return;
+    }
+    const VecDeriv& data = d->getValue();
+    const MatrixDeriv& constraints = c.getValue();
+
+    // the lines are stored in a map: list them first to share them between threads
+    std::vector<MatrixDerivRowConstIterator> rows;
+    for (MatrixDerivRowConstIterator rowIt = constraints.begin(); rowIt != constraints.end(); ++rowIt)
+    {
+        rows.push_back(rowIt);
+        lines.push_back(rowIt.index());
+    }
+    result.resize(rows.size());
+
+    std::atomic<bool> outOfRange {false};
+    parallelForDofs(rows.size(), [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t r = begin; r < end; ++r)
+        {
+            SReal value = 0;
+            MatrixDerivColConstIterator itEnd = rows[r].end();
+            for (MatrixDerivColConstIterator it = rows[r].begin(); it != itEnd; ++it)
+            {
+                if (it.index() >= data.size())
+                {
+                    outOfRange.store(true, std::memory_order_relaxed);
+                    break;
+                }
+                value += it.val() * data[it.index()];
+            }
+            result[r] = value;
+        }
+    });
+
+    if (outOfRange.load())
+    {
+        msg_error() << "getConstraintJacobianTimesVecDeriv: the constraint matrix refers to DOFs outside of "
+                    << w.getName() << " (size " << data.size() << ")";
+        lines.clear();
+        result.clear();
+    }
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::getConstraintJacobianTimesVecDeriv(const helper::vector<unsigned int>& lines, core::ConstVecDerivId w, helper::vector<SReal>& result)
+{
+    result.assign(lines.size(), 0);
+
+    const Data<VecDeriv>* d = read(w);
+    if (d == nullptr)
+    {
+        msg_error() << "getConstraintJacobianTimesVecDeriv " << "NOT IMPLEMENTED for " << w.getName();
+        return;
+    }
+    const VecDeriv& data = d->getValue();
+    const MatrixDeriv& constraints = c.getValue();
+
+    std::atomic<bool> outOfRange {false};
+    parallelForDofs(lines.size(), [&](std::size_t begin, std::size_t end)
+    {
+        for (std::size_t r = begin; r < end; ++r)
+        {
+            SReal value = 0;
+            MatrixDerivRowConstIterator rowIt = constraints.readLine(lines[r]);
+            if (rowIt != constraints.end())
+            {
+                MatrixDerivColConstIterator itEnd = rowIt.end();
+                for (MatrixDerivColConstIterator it = rowIt.begin(); it != itEnd; ++it)
+                {
+                    if (it.index() >= data.size())
+                    {
+                        outOfRange.store(true, std::memory_order_relaxed);
+                        break;
+                    }
+                    value += it.val() * data[it.index()];
+                }
+            }
+            result[r] = value;
+        }
+    });
+
+    if (outOfRange.load())
+    {
+        msg_error() << "getConstraintJacobianTimesVecDeriv: the constraint matrix refers to DOFs outside of "
+                    << w.getName() << " (size " << data.size() << ")";
+        result.assign(lines.size(), 0);
+    }
+}
+
 template <class DataTypes>
 inline void MechanicalObject<DataTypes>::drawIndices(const core::visual::VisualParams* vparams)
 {
@@ -2561,35 +4500,83 @@ inline void MechanicalObject<DataTypes>::drawIndices(const core::visual::VisualP
 
     float scale = (float)((vparams->sceneBBox().maxBBox() - vparams->sceneBBox().minBBox()).norm() * showIndicesScale.getValue());
 
-    std::vector<defaulttype::Vector3> positions;
-    for (size_t i = 0; i <(size_t)d_size.getValue(); ++i)
-        positions.push_back(defaulttype::Vector3(getPX(i), getPY(i), getPZ(i)));
+    updateDrawBuffers(false);
+    vparams->drawTool()->draw3DText_Indices(m_drawPositions, scale, color);
+}
+
+template <class DataTypes>
+void MechanicalObject<DataTypes>::updateDrawBuffers(bool withVelocities)
+{
+    const int positionsCounter = this->read(core::ConstVecCoordId::position())->getCounter();
+    const size_t n = d_size.getValue();
+    const bool positionsValid = positionsCounter == m_drawPositionsCounter && m_drawPositions.size() == n;
+    if (!withVelocities)
+    {
+        // the velocities cache is left as is, for the next call with velocities
+        if (positionsValid)
+            return;
+        m_drawPositions.resize(n);
+        if (n > 0)
+            m_drawPositions.resize(exportPositions(m_drawPositions[0].ptr(), 3, nullptr));
+        m_drawPositionsCounter = positionsCounter;
+        m_drawVectorLinesValid = false;
+        return;
+    }
+
+    const int velocitiesCounter = this->read(core::ConstVecDerivId::velocity())->getCounter();
+    if (positionsValid && velocitiesCounter == m_drawVelocitiesCounter && m_drawVelocities.size() == n)
+        return;
 
-    vparams->drawTool()->draw3DText_Indices(positions, scale, color);
+    m_drawPositions.resize(n);
+    m_drawVelocities.resize(n);
+    if (n > 0)
+    {
+        const size_t nbExported = exportPositions(m_drawPositions[0].ptr(), 3, m_drawVelocities[0].ptr());
+        m_drawPositions.resize(nbExported);
+        m_drawVelocities.resize(nbExported);
+    }
+    m_drawPositionsCounter = positionsCounter;
+    m_drawVelocitiesCounter = velocitiesCounter;
+    m_drawVectorLinesValid = false;
 }
 
 template <class DataTypes>
 inline void MechanicalObject<DataTypes>::drawVectors(const core::visual::VisualParams* vparams)
 {
     float scale = showVectorsScale.getValue();
-    sofa::helper::ReadAccessor< Data<VecDeriv> > v_rA = *this->read(core::ConstVecDerivId::velocity());
-    helper::vector<Vector3> points;
-    points.resize(2);
-    for( unsigned i=0; i<v_rA.size(); ++i )
+    const size_t nbVelocities = this->read(core::ConstVecDerivId::velocity())->getValue().size();
+    updateDrawBuffers(true);
+    const size_t n = std::min(nbVelocities, m_drawPositions.size());
+
+    if (drawMode.getValue() == 0)
+    {
+        // all the vectors in a single call, from end points kept while nothing changes
+        if (!m_drawVectorLinesValid || m_drawVectorLinesScale != scale || m_drawVectorLines.size() != 2 * n)
+        {
+            m_drawVectorLines.resize(2 * n);
+            parallelForDofs(n, [&](std::size_t begin, std::size_t end)
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    m_drawVectorLines[2 * i] = m_drawPositions[i];
+                    m_drawVectorLines[2 * i + 1] = m_drawPositions[i] + m_drawVelocities[i] * scale;
+                }
+            });
+            m_drawVectorLinesScale = scale;
+            m_drawVectorLinesValid = true;
+        }
+        vparams->drawTool()->drawLines(m_drawVectorLines, 1, defaulttype::Vec<4,float>(1.0,1.0,1.0,1.0));
+        return;
+    }
+
+    for( unsigned i=0; i<n; ++i )
     {
-        Real vx=0.0,vy=0.0,vz=0.0;
-        DataTypes::get(vx,vy,vz,v_rA[i]);
-        Vector3 p1 = Vector3(getPX(i), getPY(i), getPZ(i));
-        Vector3 p2 = Vector3(getPX(i)+scale*vx, getPY(i)+scale*vy, getPZ(i)+scale*vz);
+        Vector3 p1 = m_drawPositions[i];
+        Vector3 p2 = m_drawPositions[i] + m_drawVelocities[i]*scale;
 
         float rad = (float)( (p1-p2).norm()/20.0 );
         switch (drawMode.getValue())
         {
-        case 0:
-            points[0] = p1;
-            points[1] = p2;
-            vparams->drawTool()->drawLines(points, 1, defaulttype::Vec<4,float>(1.0,1.0,1.0,1.0));
-            break;
         case 1:
             vparams->drawTool()->drawCylinder(p1, p2, rad, defaulttype::Vec<4,float>(1.0,1.0,1.0,1.0));
             break;
@@ -2598,7 +4585,7 @@ inline void MechanicalObject<DataTypes>::drawVectors(const core::visual::VisualP
             break;
         default:
             msg_error() << "No proper drawing mode found!";
-            break;
+            return;
         }
     }
 }
@@ -2622,9 +4609,8 @@ inline void MechanicalObject<DataTypes>::draw(const core::visual::VisualParams*
     if (showObject.getValue())
     {
         const float& scale = showObjectScale.getValue();
-        helper::vector<Vector3> positions(d_size.getValue());
-        for (size_t i = 0; i < (size_t)d_size.getValue(); ++i)
-            positions[i] = Vector3(getPX(i), getPY(i), getPZ(i));
+        updateDrawBuffers(false);
+        const helper::vector<Vector3>& positions = m_drawPositions;
 
         switch (drawMode.getValue())
         {
@@ -2672,14 +4658,14 @@ bool MechanicalObject<DataTypes>::pickParticles(const core::ExecParams* /* param
 
         defaulttype::Vec<3,Real> origin((Real)rayOx, (Real)rayOy, (Real)rayOz);
         defaulttype::Vec<3,Real> direction((Real)rayDx, (Real)rayDy, (Real)rayDz);
-        for (size_t i=0; i< (size_t)d_size.getValue(); ++i)
+        auto pick = [&](size_t i)
         {
             defaulttype::Vec<3,Real> pos;
             DataTypes::get(pos[0],pos[1],pos[2],x[i]);
 
-            if (pos == origin) continue;
+            if (pos == origin) return;
             SReal dist = (pos-origin)*direction;
-            if (dist < 0) continue; // discard particles behind the camera, such as mouse position
+            if (dist < 0) return; // discard particles behind the camera, such as mouse position
 
             defaulttype::Vec<3,Real> vecPoint = (pos-origin) - direction*dist;
             SReal distToRay = vecPoint.norm2();
@@ -2688,6 +4674,22 @@ bool MechanicalObject<DataTypes>::pickParticles(const core::ExecParams* /* param
             {
                 particles.insert(std::make_pair(distToRay,std::make_pair(this,i)));
             }
+        };
+
+        // only test the particles of the grid cells crossed by the picking cone
+        std::vector<unsigned int> candidates;
+        const double rayO[3] = { rayOx, rayOy, rayOz };
+        const double rayD[3] = { rayDx, rayDy, rayDz };
+        const SpatialGrid* grid = (size_t)d_size.getValue() == x.size() ? getSpatialGrid() : nullptr;
+        if (grid && grid->queryCone(rayO, rayD, radius0, dRadius, candidates))
+        {
+            for (unsigned int i : candidates)
+                pick(i);
+        }
+        else
+        {
+            for (size_t i=0; i< (size_t)d_size.getValue(); ++i)
+                pick(i);
         }
         return true;
     }
@@ -2696,6 +4698,67 @@ bool MechanicalObject<DataTypes>::pickParticles(const core::ExecParams* /* param
 }
 
 
+template <class DataTypes>
+bool MechanicalObject<DataTypes>::getPositionsBBox(Real minBBox[3], Real maxBBox[3]) const
+{
+    const Data<VecCoord>* positions = this->read(core::ConstVecCoordId::position());
+    const VecCoord& x = positions->getValue();
+    if (x.empty())
+        return false;
+
+    const int counter = positions->getCounter();
+    if (counter != m_bboxCounter || x.size() != m_bboxSize)
+    {
+        Real p[3] = {0,0,0};
+        DataTypes::get(p[0],p[1],p[2],x[0]);
+        for (unsigned int c = 0; c < 3; ++c)
+            m_bboxMin[c] = m_bboxMax[c] = p[c];
+
+        // each chunk computes its own bounds, merged under a lock: min and max do not depend on the order
+        std::mutex mutex;
+        parallelForDofs(x.size(), [&](std::size_t begin, std::size_t end)
+        {
+            Real bmin[3] = {p[0],p[1],p[2]};
+            Real bmax[3] = {p[0],p[1],p[2]};
+            if constexpr (FlatLayout && defaulttype::DataTypeInfo<Coord>::Size <= 3)
+            {
+                // the components beyond the size of Coord are 0 for all points, as for the first one
+                nodephysics::kernels::bounds(x[begin].ptr(), end - begin, defaulttype::DataTypeInfo<Coord>::Size, bmin, bmax);
+            }
+            else
+            {
+                for (std::size_t i = begin; i < end; ++i)
+                {
+                    Real q[3] = {0,0,0};
+                    DataTypes::get(q[0],q[1],q[2],x[i]);
+                    for (unsigned int c = 0; c < 3; ++c)
+                    {
+                        if (q[c] < bmin[c]) bmin[c] = q[c];
+                        if (q[c] > bmax[c]) bmax[c] = q[c];
+                    }
+                }
+            }
+
+            std::lock_guard<std::mutex> lock(mutex);
+            for (unsigned int c = 0; c < 3; ++c)
+            {
+                if (bmin[c] < m_bboxMin[c]) m_bboxMin[c] = bmin[c];
+                if (bmax[c] > m_bboxMax[c]) m_bboxMax[c] = bmax[c];
+            }
+        });
+
+        m_bboxCounter = counter;
+        m_bboxSize = x.size();
+    }
+
+    for (unsigned int c = 0; c < 3; ++c)
+    {
+        minBBox[c] = m_bboxMin[c];
+        maxBBox[c] = m_bboxMax[c];
+    }
+    return true;
+}
+
 template <class DataTypes>
 bool MechanicalObject<DataTypes>::addBBox(SReal* minBBox, SReal* maxBBox)
 {
@@ -2704,17 +4767,14 @@ bool MechanicalObject<DataTypes>::addBBox(SReal* minBBox, SReal* maxBBox)
 
     static const unsigned spatial_dimensions = std::min( (unsigned)DataTypes::spatial_dimensions, 3u );
 
-    const VecCoord& x = read(core::ConstVecCoordId::position())->getValue();
-    for( std::size_t i=0; i<x.size(); i++ )
-    {
-        defaulttype::Vec<3,Real> p;
-        DataTypes::get( p[0], p[1], p[2], x[i] );
+    Real pmin[3], pmax[3];
+    if (!getPositionsBBox(pmin, pmax))
+        return true;
 
-        for( unsigned int j=0 ; j<spatial_dimensions; ++j )
-        {
-            if(p[j]<minBBox[j]) minBBox[j]=p[j];
-            if(p[j]>maxBBox[j]) maxBBox[j]=p[j];
-        }
+    for( unsigned int j=0 ; j<spatial_dimensions; ++j )
+    {
+        if(pmin[j]<minBBox[j]) minBBox[j]=pmin[j];
+        if(pmax[j]>maxBBox[j]) maxBBox[j]=pmax[j];
     }
     return true;
 }
@@ -2725,7 +4785,11 @@ void MechanicalObject<DataTypes>::computeBBox(const core::ExecParams* params, bo
 {
     // participating to bbox only if it is drawn
     if( onlyVisible && !showObject.getValue() ) return;
-    Inherited::computeBBox( params );
+
+    Real minBBox[3], maxBBox[3];
+    if (!getPositionsBBox(minBBox, maxBBox))
+        return;
+    this->f_bbox.setValue(params, defaulttype::TBoundingBox<Real>(minBBox, maxBBox));
 }
 
 template <class DataTypes>
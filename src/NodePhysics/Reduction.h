@@ -0,0 +1,160 @@
+/******************************************************************************
+*       SOFA, Simulation Open-Framework Architecture, development version     *
+*                (c) 2006-2019 INRIA, USTL, UJF, CNRS, MGH                    *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <NodePhysics/TaskPool.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Parallel reductions over [0,n), where f(i) returns the (double) contribution
+ * of item i. All accumulations are done in double, whatever the type of the
+ * reduced values.
+ *
+ * In deterministic mode the range is cut in chunks of fixed size, each chunk
+ * is summed with a compensated (Kahan-Babuska) sum, and the chunk results are
+ * combined pairwise in a fixed order: the result is bit-identical whatever the
+ * number of threads. In fast mode the range is cut in one part per thread and
+ * summed naively, which depends on the thread count.
+ *
+ * The parts run on the TaskPool only if parallel is set; otherwise the calling
+ * thread runs them in order, with the same result in deterministic mode.
+ */
+namespace nodephysics::reduction
+{
+
+/// Number of items per chunk in deterministic mode. Part of the reproducibility contract.
+constexpr std::size_t ChunkSize = 4096;
+
+/// Compensated sum of f(i) for i in [begin,end).
+template <class F>
+double compensatedSum(std::size_t begin, std::size_t end, const F& f)
+{
+    double sum = 0.0;
+    double c = 0.0;
+    for (std::size_t i = begin; i < end; ++i)
+    {
+        const double x = f(i);
+        const double t = sum + x;
+        if ((sum >= 0 ? sum : -sum) >= (x >= 0 ? x : -x))
+            c += (sum - t) + x;
+        else
+            c += (x - t) + sum;
+        sum = t;
+    }
+    return sum + c;
+}
+
+/// Pairwise sum of p[0..n), with a fixed association order.
+inline double pairwiseSum(const double* p, std::size_t n)
+{
+    if (n <= 8)
+    {
+        double s = 0.0;
+        for (std::size_t i = 0; i < n; ++i)
+            s += p[i];
+        return s;
+    }
+    const std::size_t h = n / 2;
+    return pairwiseSum(p, h) + pairwiseSum(p + h, n - h);
+}
+
+/// Number of parts used to split n items in fast mode.
+inline std::size_t nbFastParts(std::size_t n, bool parallel)
+{
+    if (!parallel)
+        return 1;
+    const std::size_t nbThreads = TaskPool::getInstance().getNbThreads();
+    return std::max<std::size_t>(1, std::min(nbThreads, n / ChunkSize));
+}
+
+/// Call func(i) for i in [0,nbTasks), on the TaskPool if parallel is set.
+template <class F>
+void run(std::size_t nbTasks, bool parallel, const F& func)
+{
+    if (parallel)
+        TaskPool::getInstance().run(nbTasks, func);
+    else
+        for (std::size_t i = 0; i < nbTasks; ++i)
+            func(i);
+}
+
+/// Sum of f(i) for i in [0,n).
+template <class F>
+double sum(std::size_t n, bool deterministic, bool parallel, const F& f)
+{
+    if (n == 0)
+        return 0.0;
+
+    if (deterministic)
+    {
+        const std::size_t nbChunks = (n + ChunkSize - 1) / ChunkSize;
+        std::vector<double> partials(nbChunks);
+        run(nbChunks, parallel, [&](std::size_t c)
+        {
+            partials[c] = compensatedSum(c * ChunkSize, std::min(n, (c + 1) * ChunkSize), f);
+        });
+        return pairwiseSum(partials.data(), nbChunks);
+    }
+
+    const std::size_t nbParts = nbFastParts(n, parallel);
+    std::vector<double> partials(nbParts);
+    run(nbParts, parallel, [&](std::size_t p)
+    {
+        const std::size_t end = (p + 1) * n / nbParts;
+        double s = 0.0;
+        for (std::size_t i = p * n / nbParts; i < end; ++i)
+            s += f(i);
+        partials[p] = s;
+    });
+    double s = 0.0;
+    for (double x : partials)
+        s += x;
+    return s;
+}
+
+/// Maximum of f(i) for i in [0,n), or init if n == 0. Exact, hence always reproducible.
+template <class F>
+double max(std::size_t n, double init, bool parallel, const F& f)
+{
+    if (n == 0)
+        return init;
+
+    const std::size_t nbChunks = (n + ChunkSize - 1) / ChunkSize;
+    std::vector<double> partials(nbChunks, init);
+    run(nbChunks, parallel, [&](std::size_t c)
+    {
+        double m = init;
+        const std::size_t end = std::min(n, (c + 1) * ChunkSize);
+        for (std::size_t i = c * ChunkSize; i < end; ++i)
+        {
+            const double x = f(i);
+            if (x > m) m = x;
+        }
+        partials[c] = m;
+    });
+    return *std::max_element(partials.begin(), partials.end());
+}
+
+} // namespace nodephysics::reduction
@@ -0,0 +1,309 @@
+/******************************************************************************
+*       SOFA, Simulation Open-Framework Architecture, development version     *
+*                (c) 2006-2019 INRIA, USTL, UJF, CNRS, MGH                    *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <NodePhysics/SpatialGrid.h>
+
+#include <algorithm>
+#include <cmath>
+
+namespace nodephysics
+{
+
+namespace
+{
+
+/// Average number of points per cell the grid is sized for.
+constexpr double PointsPerCell = 4.0;
+
+} // anonymous namespace
+
+void SpatialGrid::clear()
+{
+    m_points.clear();
+    m_cellStart.clear();
+    m_sorted.clear();
+    m_dims[0] = m_dims[1] = m_dims[2] = 0;
+}
+
+void SpatialGrid::build(std::vector<double> points)
+{
+    m_points = std::move(points);
+    const std::size_t n = getNbPoints();
+    if (n == 0)
+    {
+        clear();
+        return;
+    }
+
+    for (int a = 0; a < 3; ++a)
+        m_min[a] = m_max[a] = m_points[a];
+    for (std::size_t i = 1; i < n; ++i)
+    {
+        for (int a = 0; a < 3; ++a)
+        {
+            m_min[a] = std::min(m_min[a], m_points[3 * i + a]);
+            m_max[a] = std::max(m_max[a], m_points[3 * i + a]);
+        }
+    }
+
+    // cell size giving PointsPerCell points per cell on average, over the axes
+    // along which the points are spread
+    double extent[3];
+    double maxExtent = 0;
+    for (int a = 0; a < 3; ++a)
+    {
+        extent[a] = m_max[a] - m_min[a];
+        maxExtent = std::max(maxExtent, extent[a]);
+    }
+    if (!(maxExtent > 0) || !std::isfinite(maxExtent))
+    {
+        m_cellSize = 1;
+        m_dims[0] = m_dims[1] = m_dims[2] = 1;
+    }
+    else
+    {
+        double volume = 1;
+        int nbAxes = 0;
+        for (int a = 0; a < 3; ++a)
+        {
+            if (extent[a] > 1e-9 * maxExtent)
+            {
+                volume *= extent[a];
+                ++nbAxes;
+            }
+        }
+        m_cellSize = std::pow(volume * PointsPerCell / (double)n, 1.0 / nbAxes);
+
+        // bound the number of cells for very uneven distributions
+        for (;;)
+        {
+            double nbCells = 1;
+            for (int a = 0; a < 3; ++a)
+                nbCells *= std::floor(extent[a] / m_cellSize) + 1;
+            if (nbCells <= 4.0 * (double)n + 8)
+                break;
+            m_cellSize *= 1.5;
+        }
+        for (int a = 0; a < 3; ++a)
+            m_dims[a] = (int)std::floor(extent[a] / m_cellSize) + 1;
+    }
+
+    // counting sort of the points by cell, keeping the increasing order of the indices in each cell
+    const std::size_t nbCells = (std::size_t)m_dims[0] * m_dims[1] * m_dims[2];
+    std::vector<unsigned int> cells(n);
+    m_cellStart.assign(nbCells + 1, 0);
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const double* p = &m_points[3 * i];
+        cells[i] = (unsigned int)cellIndex(cellCoord(p[0], 0), cellCoord(p[1], 1), cellCoord(p[2], 2));
+        ++m_cellStart[cells[i] + 1];
+    }
+    for (std::size_t c = 0; c < nbCells; ++c)
+        m_cellStart[c + 1] += m_cellStart[c];
+
+    m_sorted.resize(n);
+    std::vector<unsigned int> next(m_cellStart.begin(), m_cellStart.end() - 1);
+    for (std::size_t i = 0; i < n; ++i)
+        m_sorted[next[cells[i]]++] = (unsigned int)i;
+}
+
+int SpatialGrid::cellCoord(double x, int axis) const
+{
+    const double t = (x - m_min[axis]) / m_cellSize;
+    if (!(t > 0)) // also catches NaN
+        return 0;
+    if (t >= m_dims[axis])
+        return m_dims[axis] - 1;
+    return (int)t;
+}
+
+void SpatialGrid::appendCells(const int lo[3], const int hi[3], std::vector<unsigned int>& indices) const
+{
+    const int i0 = std::max(lo[0], 0), i1 = std::min(hi[0], m_dims[0] - 1);
+    const int j0 = std::max(lo[1], 0), j1 = std::min(hi[1], m_dims[1] - 1);
+    const int k0 = std::max(lo[2], 0), k1 = std::min(hi[2], m_dims[2] - 1);
+    for (int k = k0; k <= k1; ++k)
+    {
+        for (int j = j0; j <= j1; ++j)
+        {
+            // cells [i0,i1] of a row are contiguous
+            const std::size_t first = cellIndex(i0, j, k);
+            const std::size_t last = cellIndex(i1, j, k);
+            if (i0 <= i1)
+                indices.insert(indices.end(), m_sorted.begin() + m_cellStart[first], m_sorted.begin() + m_cellStart[last + 1]);
+        }
+    }
+}
+
+void SpatialGrid::queryBox(const double min[3], const double max[3], std::vector<unsigned int>& indices) const
+{
+    indices.clear();
+    if (getNbPoints() == 0)
+        return;
+    for (int a = 0; a < 3; ++a)
+        if (!(min[a] <= m_max[a] && max[a] >= m_min[a] && min[a] <= max[a]))
+            return;
+
+    const int lo[3] = { cellCoord(min[0], 0), cellCoord(min[1], 1), cellCoord(min[2], 2) };
+    const int hi[3] = { cellCoord(max[0], 0), cellCoord(max[1], 1), cellCoord(max[2], 2) };
+    std::vector<unsigned int> candidates;
+    appendCells(lo, hi, candidates);
+
+    for (unsigned int i : candidates)
+    {
+        const double* p = &m_points[3 * i];
+        if (p[0] >= min[0] && p[0] <= max[0] && p[1] >= min[1] && p[1] <= max[1] && p[2] >= min[2] && p[2] <= max[2])
+            indices.push_back(i);
+    }
+    std::sort(indices.begin(), indices.end());
+}
+
+bool SpatialGrid::queryCone(const double origin[3], const double direction[3], double radius0, double dRadius,
+                            std::vector<unsigned int>& indices) const
+{
+    indices.clear();
+    const std::size_t n = getNbPoints();
+    if (n == 0)
+        return true;
+
+    // the cone is expressed with the distance along the ray, the direction must be normalized
+    const double norm2 = direction[0] * direction[0] + direction[1] * direction[1] + direction[2] * direction[2];
+    if (!(std::abs(norm2 - 1) < 1e-6))
+        return false;
+
+    // range of the distance along the ray over the bounding box of the points
+    double tMin = 0, tMax = 0;
+    for (int c = 0; c < 8; ++c)
+    {
+        double t = 0;
+        for (int a = 0; a < 3; ++a)
+            t += (((c >> a) & 1 ? m_max[a] : m_min[a]) - origin[a]) * direction[a];
+        tMin = (c == 0) ? t : std::min(tMin, t);
+        tMax = (c == 0) ? t : std::max(tMax, t);
+    }
+    // margin for the rounding errors of the callers, which may work in single precision
+    const double margin = 1e-5 * std::max(m_cellSize, std::abs(tMax) + std::abs(tMin));
+    tMin = std::max(tMin, 0.0);
+    if (tMax + margin < tMin)
+        return true;
+
+    // cells overlapped by the bounding boxes of the cone sections [t0,t1]
+    const std::size_t nbCells = m_cellStart.size() - 1;
+    std::vector<std::size_t> cells;
+    for (double t0 = tMin; t0 <= tMax + margin; t0 += m_cellSize)
+    {
+        const double t1 = t0 + m_cellSize;
+        const double radius = std::max(std::abs(radius0 + dRadius * t0), std::abs(radius0 + dRadius * t1)) + margin;
+        int lo[3], hi[3];
+        for (int a = 0; a < 3; ++a)
+        {
+            const double x0 = origin[a] + direction[a] * t0;
+            const double x1 = origin[a] + direction[a] * t1;
+            lo[a] = cellCoord(std::min(x0, x1) - radius, a);
+            hi[a] = cellCoord(std::max(x0, x1) + radius, a);
+        }
+        for (int k = lo[2]; k <= hi[2]; ++k)
+            for (int j = lo[1]; j <= hi[1]; ++j)
+                for (int i = lo[0]; i <= hi[0]; ++i)
+                    cells.push_back(cellIndex(i, j, k));
+
+        // the cone covers most of the grid: a linear scan is cheaper
+        if (cells.size() > 2 * nbCells)
+            return false;
+    }
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+    for (std::size_t c : cells)
+        indices.insert(indices.end(), m_sorted.begin() + m_cellStart[c], m_sorted.begin() + m_cellStart[c + 1]);
+    std::sort(indices.begin(), indices.end());
+    return true;
+}
+
+void SpatialGrid::queryNearest(const double p[3], std::size_t k, std::vector< std::pair<double, unsigned int> >& nearest) const
+{
+    nearest.clear();
+    const std::size_t n = getNbPoints();
+    if (n == 0 || k == 0)
+        return;
+
+    auto distance2 = [this, p](unsigned int i)
+    {
+        const double* q = &m_points[3 * i];
+        return (q[0] - p[0]) * (q[0] - p[0]) + (q[1] - p[1]) * (q[1] - p[1]) + (q[2] - p[2]) * (q[2] - p[2]);
+    };
+
+    // max-heap of the k closest points found so far, ties broken by index
+    auto consider = [&](unsigned int i)
+    {
+        const std::pair<double, unsigned int> candidate(distance2(i), i);
+        if (nearest.size() < k)
+        {
+            nearest.push_back(candidate);
+            std::push_heap(nearest.begin(), nearest.end());
+        }
+        else if (candidate < nearest.front())
+        {
+            std::pop_heap(nearest.begin(), nearest.end());
+            nearest.back() = candidate;
+            std::push_heap(nearest.begin(), nearest.end());
+        }
+    };
+
+    // visit the cells by rings of increasing distance to the cell of p: once rings [0,r] are
+    // visited, the remaining points are at least at r * cellSize from p
+    const int center[3] = { cellCoord(p[0], 0), cellCoord(p[1], 1), cellCoord(p[2], 2) };
+    const int maxRing = std::max({ m_dims[0], m_dims[1], m_dims[2] });
+    for (int r = 0; r <= maxRing; ++r)
+    {
+        for (int dk = -r; dk <= r; ++dk)
+        {
+            const int ck = center[2] + dk;
+            if (ck < 0 || ck >= m_dims[2])
+                continue;
+            for (int dj = -r; dj <= r; ++dj)
+            {
+                const int cj = center[1] + dj;
+                if (cj < 0 || cj >= m_dims[1])
+                    continue;
+                // inside the ring, only the first and last cells of the row are on it
+                const bool onRing = std::abs(dk) == r || std::abs(dj) == r;
+                for (int di = -r; di <= r; di += (onRing || r == 0) ? 1 : 2 * r)
+                {
+                    const int ci = center[0] + di;
+                    if (ci < 0 || ci >= m_dims[0])
+                        continue;
+                    const std::size_t c = cellIndex(ci, cj, ck);
+                    for (unsigned int s = m_cellStart[c]; s < m_cellStart[c + 1]; ++s)
+                        consider(m_sorted[s]);
+                }
+            }
+        }
+
+        const double bound = r * m_cellSize;
+        if (nearest.size() == k && nearest.front().first < bound * bound)
+            break;
+    }
+
+    std::sort_heap(nearest.begin(), nearest.end());
+}
+
+} // namespace nodephysics
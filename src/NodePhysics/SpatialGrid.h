@@ -0,0 +1,81 @@
+/******************************************************************************
+*       SOFA, Simulation Open-Framework Architecture, development version     *
+*                (c) 2006-2019 INRIA, USTL, UJF, CNRS, MGH                    *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <NodePhysics/config.h>
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+namespace nodephysics
+{
+
+/**
+ * @brief Uniform grid over a set of 3D points, for box, cone and nearest neighbors queries.
+ *
+ * The grid covers the bounding box of the points, with a cell size chosen to
+ * hold a few points per cell. Points are sorted by cell (counting sort), so
+ * that the points of a cell are contiguous. The grid does not follow the
+ * points: it must be rebuilt when they move.
+ */
+class SOFA_NODEPHYSICS_API SpatialGrid
+{
+public:
+    /// Build the grid over the points, point i being (points[3i], points[3i+1], points[3i+2]).
+    void build(std::vector<double> points);
+
+    void clear();
+
+    std::size_t getNbPoints() const { return m_points.size() / 3; }
+
+    /// Indices of the points inside [min,max] (bounds included), in increasing order.
+    void queryBox(const double min[3], const double max[3], std::vector<unsigned int>& indices) const;
+
+    /// Indices of the points which may be within radius0 + dRadius * t of the ray
+    /// origin + t * direction (t >= 0), in increasing order. The result is a superset
+    /// of the points inside the cone: callers apply their exact test on it.
+    /// Returns false if the grid does not help (direction not normalized, or cone
+    /// covering most of the grid), in which case all points should be tested.
+    bool queryCone(const double origin[3], const double direction[3], double radius0, double dRadius,
+                   std::vector<unsigned int>& indices) const;
+
+    /// The k points closest to p, as (squared distance, index) sorted by increasing distance.
+    void queryNearest(const double p[3], std::size_t k, std::vector< std::pair<double, unsigned int> >& nearest) const;
+
+private:
+    std::size_t cellIndex(int i, int j, int k) const { return ((std::size_t)k * m_dims[1] + j) * m_dims[0] + i; }
+    int cellCoord(double x, int axis) const;
+
+    /// Append the points of the cells [lo,hi] (cell coordinates, clamped to the grid) to indices.
+    void appendCells(const int lo[3], const int hi[3], std::vector<unsigned int>& indices) const;
+
+    std::vector<double> m_points;
+    double m_min[3] {0, 0, 0};
+    double m_max[3] {0, 0, 0};
+    double m_cellSize {1};
+    int m_dims[3] {0, 0, 0};
+    std::vector<unsigned int> m_cellStart; ///< points of cell c are m_sorted[m_cellStart[c]..m_cellStart[c+1])
+    std::vector<unsigned int> m_sorted; ///< point indices sorted by cell
+};
+
+} // namespace nodephysics
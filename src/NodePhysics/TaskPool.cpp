@@ -0,0 +1,194 @@
+/******************************************************************************
+*       SOFA, Simulation Open-Framework Architecture, development version     *
+*                (c) 2006-2019 INRIA, USTL, UJF, CNRS, MGH                    *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <NodePhysics/TaskPool.h>
+
+#include <cstdlib>
+
+namespace nodephysics
+{
+
+namespace
+{
+
+/// Set while a thread executes a task, to run nested batches sequentially.
+thread_local bool insideTask = false;
+
+unsigned int defaultNbThreads()
+{
+    if (const char* env = std::getenv("NODEPHYSICS_NUM_THREADS"))
+    {
+        const int n = std::atoi(env);
+        if (n > 0)
+            return (unsigned int)n;
+    }
+    const unsigned int n = std::thread::hardware_concurrency();
+    return n > 0 ? n : 1;
+}
+
+} // anonymous namespace
+
+TaskPool& TaskPool::getInstance()
+{
+    static TaskPool pool(defaultNbThreads());
+    return pool;
+}
+
+TaskPool::TaskPool(unsigned int nbThreads)
+{
+    for (unsigned int i = 1; i < nbThreads; ++i)
+        m_workers.emplace_back([this, i]() { workerLoop(i - 1); });
+}
+
+TaskPool::~TaskPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+    for (std::thread& t : m_workers)
+        t.join();
+}
+
+bool TaskPool::pop(Range& range, std::size_t& task)
+{
+    std::lock_guard<std::mutex> lock(range.mutex);
+    if (range.begin >= range.end)
+        return false;
+    task = range.begin++;
+    return true;
+}
+
+bool TaskPool::steal(Batch& batch, unsigned int thief)
+{
+    const unsigned int nbRanges = (unsigned int)batch.ranges.size();
+    for (unsigned int k = 1; k < nbRanges; ++k)
+    {
+        Range& victim = batch.ranges[(thief + k) % nbRanges];
+        std::size_t begin, end;
+        {
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (victim.begin >= victim.end)
+                continue;
+            // take the second half, the victim keeps the tasks it will run next
+            // (a single task left is taken, the middle being rounded down)
+            const std::size_t middle = victim.begin + (victim.end - victim.begin) / 2;
+            begin = middle;
+            end = victim.end;
+            victim.end = middle;
+        }
+
+        Range& own = batch.ranges[thief];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        own.begin = begin;
+        own.end = end;
+        return true;
+    }
+    return false;
+}
+
+void TaskPool::execute(Batch& batch, unsigned int index)
+{
+    const bool wasInsideTask = insideTask;
+    insideTask = true;
+    std::size_t task;
+    for (;;)
+    {
+        while (pop(batch.ranges[index], task))
+            (*batch.func)(task);
+        if (!steal(batch, index))
+            break;
+    }
+    insideTask = wasInsideTask;
+}
+
+void TaskPool::workerLoop(unsigned int index)
+{
+    unsigned long generation = 0;
+    for (;;)
+    {
+        Batch* batch = nullptr;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait(lock, [&]() { return m_stop || (m_batch != nullptr && m_generation != generation); });
+            if (m_stop)
+                return;
+            generation = m_generation;
+            batch = m_batch;
+            ++batch->activeWorkers;
+        }
+
+        execute(*batch, index);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--batch->activeWorkers == 0)
+                m_finished.notify_all();
+        }
+    }
+}
+
+void TaskPool::run(std::size_t nbTasks, const std::function<void(std::size_t)>& func)
+{
+    if (nbTasks == 0)
+        return;
+
+    if (nbTasks == 1 || m_workers.empty() || insideTask)
+    {
+        // the calling thread runs the tasks: batches nested in them run sequentially as well
+        const bool wasInsideTask = insideTask;
+        insideTask = true;
+        for (std::size_t i = 0; i < nbTasks; ++i)
+            func(i);
+        insideTask = wasInsideTask;
+        return;
+    }
+
+    std::lock_guard<std::mutex> runLock(m_runMutex);
+
+    const unsigned int nbThreads = getNbThreads();
+    Batch batch;
+    batch.func = &func;
+    batch.ranges = std::vector<Range>(nbThreads);
+    for (unsigned int t = 0; t < nbThreads; ++t)
+    {
+        batch.ranges[t].begin = t * nbTasks / nbThreads;
+        batch.ranges[t].end = (t + 1) * nbTasks / nbThreads;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_batch = &batch;
+        ++m_generation;
+    }
+    m_wakeUp.notify_all();
+
+    execute(batch, nbThreads - 1);
+
+    // no task left to run or steal: wait for the workers still executing theirs
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_finished.wait(lock, [&]() { return batch.activeWorkers == 0; });
+        m_batch = nullptr;
+    }
+}
+
+} // namespace nodephysics
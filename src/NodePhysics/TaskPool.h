@@ -0,0 +1,125 @@
+/******************************************************************************
+*       SOFA, Simulation Open-Framework Architecture, development version     *
+*                (c) 2006-2019 INRIA, USTL, UJF, CNRS, MGH                    *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <NodePhysics/config.h>
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace nodephysics
+{
+
+/**
+ * @brief Work-stealing pool of worker threads owned by the plugin.
+ *
+ * The pool runs batches of independent tasks: run(n, func) calls func(i) for
+ * every i in [0,n) and returns once all of them are done. The task indices
+ * are initially split in one contiguous range per thread; a thread runs the
+ * tasks of its own range in order, and once it is empty steals half of the
+ * remaining range of another thread. The calling thread takes part in the
+ * work. Calls made from inside a task are executed sequentially by the
+ * calling thread.
+ *
+ * The number of threads defaults to the number of hardware threads and can be
+ * set with the NODEPHYSICS_NUM_THREADS environment variable.
+ */
+class SOFA_NODEPHYSICS_API TaskPool
+{
+public:
+    static TaskPool& getInstance();
+
+    /// Number of threads taking part in a batch, including the calling thread.
+    unsigned int getNbThreads() const { return (unsigned int)m_workers.size() + 1; }
+
+    /// Call func(i) for i in [0,nbTasks), in parallel.
+    void run(std::size_t nbTasks, const std::function<void(std::size_t)>& func);
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+private:
+    explicit TaskPool(unsigned int nbThreads);
+    ~TaskPool();
+
+    /// Remaining task indices [begin,end) of one thread.
+    struct Range
+    {
+        std::mutex mutex;
+        std::size_t begin {0};
+        std::size_t end {0};
+    };
+
+    struct Batch
+    {
+        const std::function<void(std::size_t)>* func {nullptr};
+        std::vector<Range> ranges; ///< one per thread, the calling thread being the last one
+        unsigned int activeWorkers {0}; ///< workers currently executing tasks of this batch, protected by m_mutex
+    };
+
+    void workerLoop(unsigned int index);
+    void execute(Batch& batch, unsigned int index);
+    bool pop(Range& range, std::size_t& task);
+    bool steal(Batch& batch, unsigned int thief);
+
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    std::condition_variable m_finished;
+    Batch* m_batch {nullptr};
+    unsigned long m_generation {0};
+    bool m_stop {false};
+    std::mutex m_runMutex; ///< one batch at a time
+};
+
+/// Call f(b,e) on consecutive sub-ranges [b,e) of [begin,end), in parallel if
+/// the range holds more than grain items. A grain of 0 disables parallelism.
+template <class F>
+void parallelFor(std::size_t begin, std::size_t end, std::size_t grain, const F& f)
+{
+    if (end <= begin)
+        return;
+
+    const std::size_t n = end - begin;
+    TaskPool& pool = TaskPool::getInstance();
+    if (grain == 0 || n <= grain || pool.getNbThreads() == 1)
+    {
+        f(begin, end);
+        return;
+    }
+
+    // a few chunks per thread so that stealing can balance uneven work
+    const std::size_t target = (n + 8 * pool.getNbThreads() - 1) / (8 * pool.getNbThreads());
+    const std::size_t chunk = target > grain ? target : grain;
+    const std::size_t nbChunks = (n + chunk - 1) / chunk;
+    pool.run(nbChunks, [&](std::size_t c)
+    {
+        const std::size_t b = begin + c * chunk;
+        f(b, (b + chunk < end) ? b + chunk : end);
+    });
+}
+
+} // namespace nodephysics
@@ -0,0 +1,311 @@
+/******************************************************************************
+*       SOFA, Simulation Open-Framework Architecture, development version     *
+*                (c) 2006-2019 INRIA, USTL, UJF, CNRS, MGH                    *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#define SOFA_NODEPHYSICS_TRAJECTORYRECORDER_CPP
+#include <NodePhysics/TrajectoryRecorder.inl>
+#include <sofa/core/ObjectFactory.h>
+
+#include <algorithm>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define NODEPHYSICS_TRAJECTORY_MMAP
+#endif
+
+namespace nodephysics
+{
+
+namespace
+{
+
+constexpr char TrajectoryMagic[8] = {'N','P','H','Y','S','T','R','J'};
+constexpr std::uint32_t TrajectoryVersion = 1;
+constexpr std::uint32_t TrajectoryByteOrderMark = 0x01020304u;
+
+/// magic, version, byte order mark, number of records, file size
+constexpr std::size_t PrefixSize = 32;
+
+/// the file is grown by doubling past this size, rather than reserved at once
+constexpr std::size_t MaxInitialCapacity = std::size_t(64) << 20;
+
+} // anonymous namespace
+
+TrajectoryWriter::~TrajectoryWriter()
+{
+    close();
+}
+
+bool TrajectoryWriter::open(const std::string& filename, const std::vector<char>& header, std::size_t nbBuffers, std::size_t capacity)
+{
+    close();
+
+    std::vector<char> prefix(PrefixSize, 0);
+    std::memcpy(prefix.data(), TrajectoryMagic, 8);
+    std::memcpy(prefix.data() + 8, &TrajectoryVersion, 4);
+    std::memcpy(prefix.data() + 12, &TrajectoryByteOrderMark, 4);
+    prefix.insert(prefix.end(), header.begin(), header.end());
+    prefix.resize((prefix.size() + 7) / 8 * 8, 0);
+
+    m_nbRecords = 0;
+    m_nbDropped = 0;
+    m_failed = false;
+    m_stop = false;
+    m_end = 0;
+    m_capacity = 0;
+
+#ifdef NODEPHYSICS_TRAJECTORY_MMAP
+    m_fd = ::open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0)
+        return false;
+    if (!reserve(std::max(std::min(capacity, MaxInitialCapacity), prefix.size())))
+    {
+        ::close(m_fd);
+        m_fd = -1;
+        return false;
+    }
+    std::memcpy(m_map, prefix.data(), prefix.size());
+#else
+    SOFA_UNUSED(capacity);
+    m_file = std::fopen(filename.c_str(), "wb");
+    if (m_file == nullptr)
+        return false;
+    if (std::fwrite(prefix.data(), 1, prefix.size(), m_file) != prefix.size())
+    {
+        std::fclose(m_file);
+        m_file = nullptr;
+        return false;
+    }
+#endif
+    m_end = prefix.size();
+
+    m_buffers.assign(std::max<std::size_t>(nbBuffers, 1), Buffer());
+    m_free.clear();
+    for (std::size_t i = m_buffers.size(); i > 0; --i)
+        m_free.push_back(i - 1);
+    m_ready.clear();
+
+    m_thread = std::thread([this]() { writerLoop(); });
+    return true;
+}
+
+void TrajectoryWriter::close()
+{
+    if (!m_thread.joinable())
+        return;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+    m_wakeUp.notify_all();
+    m_thread.join();
+
+    finalize();
+}
+
+char* TrajectoryWriter::acquire(std::size_t nbBytes)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_failed || m_free.empty())
+        {
+            ++m_nbDropped;
+            return nullptr;
+        }
+        m_acquired = m_free.back();
+        m_free.pop_back();
+    }
+
+    // the buffers only grow, so that they stop allocating once the record sizes are known
+    Buffer& buffer = m_buffers[m_acquired];
+    if (buffer.data.size() < nbBytes)
+        buffer.data.resize(nbBytes);
+    buffer.size = nbBytes;
+    return buffer.data.data();
+}
+
+void TrajectoryWriter::commit()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_ready.push_back(m_acquired);
+    }
+    m_wakeUp.notify_one();
+}
+
+std::uint64_t TrajectoryWriter::getNbRecords() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_nbRecords;
+}
+
+std::uint64_t TrajectoryWriter::getNbDropped() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_nbDropped;
+}
+
+bool TrajectoryWriter::hasFailed() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_failed;
+}
+
+void TrajectoryWriter::writerLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    for (;;)
+    {
+        m_wakeUp.wait(lock, [this]() { return m_stop || !m_ready.empty(); });
+        if (m_ready.empty())
+            return; // stopped, and all records written
+
+        const std::size_t b = m_ready.front();
+        m_ready.pop_front();
+
+        lock.unlock();
+        const bool written = !m_failed && writeRecord(m_buffers[b]);
+        lock.lock();
+
+        if (written)
+            ++m_nbRecords;
+        else
+        {
+            // the records queued after a write error are dropped as well
+            m_failed = true;
+            ++m_nbDropped;
+        }
+        m_free.push_back(b);
+    }
+}
+
+bool TrajectoryWriter::reserve(std::size_t size)
+{
+#ifdef NODEPHYSICS_TRAJECTORY_MMAP
+    if (size <= m_capacity)
+        return true;
+
+    const std::size_t capacity = std::max(size, std::max<std::size_t>(2 * m_capacity, 1 << 20));
+    if (m_map != nullptr)
+    {
+        ::munmap(m_map, m_capacity);
+        m_map = nullptr;
+    }
+#ifdef __linux__
+    // allocate the blocks now rather than on the first write to each page
+    if (::posix_fallocate(m_fd, 0, (off_t)capacity) != 0 && ::ftruncate(m_fd, (off_t)capacity) != 0)
+        return false;
+#else
+    if (::ftruncate(m_fd, (off_t)capacity) != 0)
+        return false;
+#endif
+    void* p = ::mmap(nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (p == MAP_FAILED)
+        return false;
+    m_map = static_cast<char*>(p);
+    m_capacity = capacity;
+    return true;
+#else
+    SOFA_UNUSED(size);
+    return true;
+#endif
+}
+
+bool TrajectoryWriter::writeRecord(const Buffer& buffer)
+{
+#ifdef NODEPHYSICS_TRAJECTORY_MMAP
+    if (!reserve(m_end + buffer.size))
+        return false;
+    std::memcpy(m_map + m_end, buffer.data.data(), buffer.size);
+#else
+    if (std::fwrite(buffer.data.data(), 1, buffer.size, m_file) != buffer.size)
+        return false;
+#endif
+    m_end += buffer.size;
+    return true;
+}
+
+void TrajectoryWriter::finalize()
+{
+    const std::uint64_t nbRecords = m_nbRecords;
+    const std::uint64_t fileSize = m_end;
+
+#ifdef NODEPHYSICS_TRAJECTORY_MMAP
+    if (m_map != nullptr)
+    {
+        std::memcpy(m_map + 16, &nbRecords, 8);
+        std::memcpy(m_map + 24, &fileSize, 8);
+        ::munmap(m_map, m_capacity);
+        m_map = nullptr;
+    }
+    if (m_fd >= 0)
+    {
+        if (::ftruncate(m_fd, (off_t)m_end) != 0)
+            m_failed = true;
+        ::close(m_fd);
+        m_fd = -1;
+    }
+    m_capacity = 0;
+#else
+    if (m_file != nullptr)
+    {
+        std::fseek(m_file, 16, SEEK_SET);
+        std::fwrite(&nbRecords, 8, 1, m_file);
+        std::fwrite(&fileSize, 8, 1, m_file);
+        std::fclose(m_file);
+        m_file = nullptr;
+    }
+#endif
+}
+
+using namespace sofa::defaulttype;
+
+int TrajectoryRecorderClass = core::RegisterObject("Record state vectors at the end of each time step in a binary file written by a background thread")
+        .add< TrajectoryRecorder<Vec3Types> >(true) // default template
+        .add< TrajectoryRecorder<Vec2Types> >()
+        .add< TrajectoryRecorder<Vec1Types> >()
+        .add< TrajectoryRecorder<Vec6Types> >()
+        .add< TrajectoryRecorder<Rigid3Types> >()
+        .add< TrajectoryRecorder<Rigid2Types> >()
+        .add< TrajectoryRecorder<Vec3fTypes> >()
+        .add< TrajectoryRecorder<Vec2fTypes> >()
+        .add< TrajectoryRecorder<Vec1fTypes> >()
+        .add< TrajectoryRecorder<Vec6fTypes> >()
+        .add< TrajectoryRecorder<Rigid3fTypes> >()
+        .add< TrajectoryRecorder<Rigid2fTypes> >();
+
+template class SOFA_NODEPHYSICS_API TrajectoryRecorder<Vec3Types>;
+template class SOFA_NODEPHYSICS_API TrajectoryRecorder<Vec2Types>;
+template class SOFA_NODEPHYSICS_API TrajectoryRecorder<Vec1Types>;
+template class SOFA_NODEPHYSICS_API TrajectoryRecorder<Vec6Types>;
+template class SOFA_NODEPHYSICS_API TrajectoryRecorder<Rigid3Types>;
+template class SOFA_NODEPHYSICS_API TrajectoryRecorder<Rigid2Types>;
+template class SOFA_NODEPHYSICS_API TrajectoryRecorder<Vec3fTypes>;
+template class SOFA_NODEPHYSICS_API TrajectoryRecorder<Vec2fTypes>;
+template class SOFA_NODEPHYSICS_API TrajectoryRecorder<Vec1fTypes>;
+template class SOFA_NODEPHYSICS_API TrajectoryRecorder<Vec6fTypes>;
+template class SOFA_NODEPHYSICS_API TrajectoryRecorder<Rigid3fTypes>;
+template class SOFA_NODEPHYSICS_API TrajectoryRecorder<Rigid2fTypes>;
+
+} // namespace nodephysics
@@ -0,0 +1,198 @@
+/******************************************************************************
+*       SOFA, Simulation Open-Framework Architecture, development version     *
+*                (c) 2006-2019 INRIA, USTL, UJF, CNRS, MGH                    *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <NodePhysics/config.h>
+
+#include <sofa/core/objectmodel/BaseObject.h>
+#include <sofa/core/behavior/MechanicalState.h>
+#include <sofa/defaulttype/VecTypes.h>
+#include <sofa/defaulttype/RigidTypes.h>
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace nodephysics
+{
+
+using namespace sofa;
+using namespace sofa::core;
+using namespace sofa::defaulttype;
+using namespace sofa::core::objectmodel;
+
+/**
+ * @brief Background writer of a trajectory file.
+ *
+ * The simulation thread fills records in a ring of preallocated buffers
+ * (acquire/commit); a background thread copies them into the file, which is
+ * memory-mapped and grown by doubling when the platform allows it. When all
+ * buffers are waiting to be written, new records are dropped instead of
+ * blocking the simulation. After a write error, all records are dropped.
+ *
+ * File layout: magic "NPHYSTRJ", version, byte order mark, number of records,
+ * size of the file in bytes, then the header given to open() and the records,
+ * each block being 8 bytes aligned.
+ */
+class SOFA_NODEPHYSICS_API TrajectoryWriter
+{
+public:
+    TrajectoryWriter() = default;
+    ~TrajectoryWriter();
+
+    TrajectoryWriter(const TrajectoryWriter&) = delete;
+    TrajectoryWriter& operator=(const TrajectoryWriter&) = delete;
+
+    /// Create the file, reserve capacity bytes for it (at most 64 MB, the file then grows on demand), and start the writer thread.
+    bool open(const std::string& filename, const std::vector<char>& header, std::size_t nbBuffers, std::size_t capacity);
+
+    /// Wait for the pending records, then finalize and close the file.
+    void close();
+
+    bool isOpen() const { return m_thread.joinable(); }
+
+    /// Buffer of nbBytes for the next record, or nullptr if none is available (the record is dropped).
+    char* acquire(std::size_t nbBytes);
+
+    /// Queue the record filled in the buffer returned by the last acquire.
+    void commit();
+
+    std::uint64_t getNbRecords() const;
+    std::uint64_t getNbDropped() const;
+
+    /// True once a record could not be written.
+    bool hasFailed() const;
+
+private:
+    struct Buffer
+    {
+        std::vector<char> data;
+        std::size_t size {0};
+    };
+
+    void writerLoop();
+    bool writeRecord(const Buffer& buffer);
+    bool reserve(std::size_t size);
+    void finalize();
+
+    std::vector<Buffer> m_buffers;
+    std::vector<std::size_t> m_free; ///< buffers available to the simulation thread
+    std::deque<std::size_t> m_ready; ///< buffers waiting to be written, in order
+    std::size_t m_acquired {0};
+    mutable std::mutex m_mutex;
+    std::condition_variable m_wakeUp;
+    bool m_stop {false};
+    std::thread m_thread;
+
+    // file state, only used by the writer thread once it is started
+    int m_fd {-1};
+    char* m_map {nullptr};
+    std::size_t m_capacity {0};
+    std::size_t m_end {0};
+    std::FILE* m_file {nullptr}; ///< used when the file cannot be mapped
+    std::uint64_t m_nbRecords {0};
+    std::uint64_t m_nbDropped {0};
+    bool m_failed {false};
+};
+
+/**
+ * @brief Record state vectors of a mechanical state at the end of each time step.
+ *
+ * The selected vectors are copied into the buffers of a TrajectoryWriter at
+ * each AnimateEndEvent, the file being written by a background thread.
+ *
+ * Each record holds: index of the vector in the "vectors" list, DOF stride,
+ * step number, simulation time, number of values, and the raw Coord/Deriv
+ * values of the DOFs 0, stride, 2*stride...
+ */
+template <class DataTypes>
+class TrajectoryRecorder : public core::objectmodel::BaseObject
+{
+public:
+    SOFA_CLASS(SOFA_TEMPLATE(TrajectoryRecorder, DataTypes), core::objectmodel::BaseObject);
+
+    typedef typename DataTypes::Coord    Coord;
+    typedef typename DataTypes::Deriv    Deriv;
+    typedef typename DataTypes::VecCoord VecCoord;
+    typedef typename DataTypes::VecDeriv VecDeriv;
+    typedef core::behavior::MechanicalState<DataTypes> MState;
+
+    Data< std::string > d_filename; ///< Output file
+    Data< helper::vector<std::string> > d_vectors; ///< Names of the recorded vectors of the mechanical state (default=position)
+    Data< helper::vector<unsigned int> > d_strides; ///< Record one DOF out of N, for each vector (default=1)
+    Data< helper::vector<unsigned int> > d_decimations; ///< Record one step out of N, for each vector (default=1)
+    Data< unsigned int > d_nbBuffers; ///< Number of records which can wait to be written before new ones are dropped (default=16)
+    Data< unsigned int > d_reserveSteps; ///< Number of steps the file is initially sized for, up to 64 MB (default=1000)
+    Data< unsigned long > d_nbRecords; ///< Number of records written
+    Data< unsigned long > d_nbDropped; ///< Number of records dropped because the writer was too slow or failed
+
+    SingleLink< TrajectoryRecorder<DataTypes>, MState, BaseLink::FLAG_STOREPATH | BaseLink::FLAG_STRONGLINK > l_mstate;
+
+    void init() override;
+    void cleanup() override;
+    void handleEvent(sofa::core::objectmodel::Event* event) override;
+
+protected:
+    TrajectoryRecorder();
+    ~TrajectoryRecorder() override;
+
+    struct RecordedVector
+    {
+        const Data<VecCoord>* coord {nullptr};
+        const Data<VecDeriv>* deriv {nullptr};
+        unsigned int stride {1};
+        unsigned int decimation {1};
+    };
+
+    /// Copy the selected vectors due at this step.
+    void record();
+
+    /// Update nbRecords and nbDropped, and report a write error once.
+    void updateStatus();
+
+    helper::vector<RecordedVector> m_vectors;
+    TrajectoryWriter m_writer;
+    std::uint64_t m_step {0};
+    bool m_failureReported {false};
+};
+
+#if !defined(SOFA_NODEPHYSICS_TRAJECTORYRECORDER_CPP)
+extern template class SOFA_NODEPHYSICS_API TrajectoryRecorder<defaulttype::Vec3Types>;
+extern template class SOFA_NODEPHYSICS_API TrajectoryRecorder<defaulttype::Vec2Types>;
+extern template class SOFA_NODEPHYSICS_API TrajectoryRecorder<defaulttype::Vec1Types>;
+extern template class SOFA_NODEPHYSICS_API TrajectoryRecorder<defaulttype::Vec6Types>;
+extern template class SOFA_NODEPHYSICS_API TrajectoryRecorder<defaulttype::Rigid3Types>;
+extern template class SOFA_NODEPHYSICS_API TrajectoryRecorder<defaulttype::Rigid2Types>;
+extern template class SOFA_NODEPHYSICS_API TrajectoryRecorder<defaulttype::Vec3fTypes>;
+extern template class SOFA_NODEPHYSICS_API TrajectoryRecorder<defaulttype::Vec2fTypes>;
+extern template class SOFA_NODEPHYSICS_API TrajectoryRecorder<defaulttype::Vec1fTypes>;
+extern template class SOFA_NODEPHYSICS_API TrajectoryRecorder<defaulttype::Vec6fTypes>;
+extern template class SOFA_NODEPHYSICS_API TrajectoryRecorder<defaulttype::Rigid3fTypes>;
+extern template class SOFA_NODEPHYSICS_API TrajectoryRecorder<defaulttype::Rigid2fTypes>;
+#endif
+
+} // namespace nodephysics
@@ -0,0 +1,209 @@
+/******************************************************************************
+*       SOFA, Simulation Open-Framework Architecture, development version     *
+*                (c) 2006-2019 INRIA, USTL, UJF, CNRS, MGH                    *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <NodePhysics/TrajectoryRecorder.h>
+
+#include <sofa/simulation/AnimateEndEvent.h>
+
+#include <cstring>
+
+namespace nodephysics
+{
+
+template <class DataTypes>
+TrajectoryRecorder<DataTypes>::TrajectoryRecorder()
+    : d_filename(initData(&d_filename, "filename", "Output file"))
+    , d_vectors(initData(&d_vectors, helper::vector<std::string>(1, "position"), "vectors", "Names of the recorded vectors of the mechanical state (default=position)"))
+    , d_strides(initData(&d_strides, "strides", "Record one DOF out of N, for each vector (default=1)"))
+    , d_decimations(initData(&d_decimations, "decimations", "Record one step out of N, for each vector (default=1)"))
+    , d_nbBuffers(initData(&d_nbBuffers, 16u, "nbBuffers", "Number of records which can wait to be written before new ones are dropped (default=16)"))
+    , d_reserveSteps(initData(&d_reserveSteps, 1000u, "reserveSteps", "Number of steps the file is initially sized for, up to 64 MB (default=1000)"))
+    , d_nbRecords(initData(&d_nbRecords, 0ul, "nbRecords", "Number of records written"))
+    , d_nbDropped(initData(&d_nbDropped, 0ul, "nbDropped", "Number of records dropped because the writer was too slow or failed"))
+    , l_mstate(initLink("mstate", "Recorded mechanical state (default: the one of the context)"))
+{
+    d_nbRecords.setReadOnly(true);
+    d_nbDropped.setReadOnly(true);
+    this->f_listening.setValue(true);
+}
+
+template <class DataTypes>
+TrajectoryRecorder<DataTypes>::~TrajectoryRecorder()
+{
+    m_writer.close();
+}
+
+template <class DataTypes>
+void TrajectoryRecorder<DataTypes>::init()
+{
+    if (!l_mstate)
+        l_mstate.set(dynamic_cast<MState*>(this->getContext()->getMechanicalState()));
+    if (!l_mstate)
+    {
+        msg_error() << "No mechanical state of template " << DataTypes::Name() << " found.";
+        return;
+    }
+    if (d_filename.getValue().empty())
+    {
+        msg_error() << "No output file given.";
+        return;
+    }
+
+    auto append = [](std::vector<char>& buffer, const void* data, std::size_t nbBytes)
+    {
+        buffer.insert(buffer.end(), static_cast<const char*>(data), static_cast<const char*>(data) + nbBytes);
+    };
+    auto appendValue = [&append](std::vector<char>& buffer, std::uint32_t value) { append(buffer, &value, sizeof(value)); };
+    auto appendString = [&append, &appendValue](std::vector<char>& buffer, const std::string& str)
+    {
+        appendValue(buffer, (std::uint32_t)str.size());
+        append(buffer, str.data(), str.size());
+        buffer.resize((buffer.size() + 7) / 8 * 8, 0);
+    };
+
+    // header: sizes of Real/Coord/Deriv, template name, number of vectors, then for each vector
+    // its kind (0: Coord, 1: Deriv), stride, decimation and name
+    std::vector<char> header;
+    appendValue(header, (std::uint32_t)sizeof(typename DataTypes::Real));
+    appendValue(header, (std::uint32_t)sizeof(Coord));
+    appendValue(header, (std::uint32_t)sizeof(Deriv));
+    appendString(header, DataTypes::Name());
+
+    const helper::vector<std::string>& names = d_vectors.getValue();
+    const helper::vector<unsigned int>& strides = d_strides.getValue();
+    const helper::vector<unsigned int>& decimations = d_decimations.getValue();
+    m_vectors.clear();
+    std::vector<char> vectorsHeader;
+    std::size_t bytesPerStep = 0;
+    for (unsigned int i = 0; i < names.size(); ++i)
+    {
+        RecordedVector v;
+        BaseData* d = l_mstate->findData(names[i]);
+        v.coord = dynamic_cast< const Data<VecCoord>* >(d);
+        if (!v.coord)
+            v.deriv = dynamic_cast< const Data<VecDeriv>* >(d);
+        if (!v.coord && !v.deriv)
+        {
+            msg_warning() << "No vector named " << names[i] << " in " << l_mstate->getName() << ", it will not be recorded.";
+            continue;
+        }
+        v.stride = (i < strides.size() && strides[i] > 0) ? strides[i] : 1;
+        v.decimation = (i < decimations.size() && decimations[i] > 0) ? decimations[i] : 1;
+        m_vectors.push_back(v);
+
+        const std::size_t nbValues = v.coord ? v.coord->getValue().size() : v.deriv->getValue().size();
+        const std::size_t valueSize = v.coord ? sizeof(Coord) : sizeof(Deriv);
+        bytesPerStep += (32 + (nbValues + v.stride - 1) / v.stride * valueSize + 7) / v.decimation;
+
+        appendValue(vectorsHeader, v.coord ? 0u : 1u);
+        appendValue(vectorsHeader, v.stride);
+        appendValue(vectorsHeader, v.decimation);
+        appendString(vectorsHeader, names[i]);
+    }
+    appendValue(header, (std::uint32_t)m_vectors.size());
+    appendValue(header, 0u);
+    header.insert(header.end(), vectorsHeader.begin(), vectorsHeader.end());
+
+    m_step = 0;
+    m_failureReported = false;
+    const std::size_t capacity = header.size() + bytesPerStep * d_reserveSteps.getValue();
+    if (!m_writer.open(d_filename.getValue(), header, d_nbBuffers.getValue(), capacity))
+        msg_error() << "Cannot create file " << d_filename.getValue();
+}
+
+template <class DataTypes>
+void TrajectoryRecorder<DataTypes>::cleanup()
+{
+    m_writer.close();
+    updateStatus();
+}
+
+template <class DataTypes>
+void TrajectoryRecorder<DataTypes>::handleEvent(sofa::core::objectmodel::Event* event)
+{
+    if (sofa::simulation::AnimateEndEvent::checkEventType(event))
+        record();
+}
+
+template <class DataTypes>
+void TrajectoryRecorder<DataTypes>::record()
+{
+    if (!m_writer.isOpen())
+        return;
+
+    const double time = this->getContext()->getTime();
+    for (unsigned int k = 0; k < m_vectors.size(); ++k)
+    {
+        const RecordedVector& v = m_vectors[k];
+        if (m_step % v.decimation != 0)
+            continue;
+
+        auto recordValues = [&](const auto& values)
+        {
+            typedef typename std::decay<decltype(values[0])>::type Value;
+            const std::uint64_t count = (values.size() + v.stride - 1) / v.stride;
+            const std::size_t nbBytes = 32 + (count * sizeof(Value) + 7) / 8 * 8;
+            char* p = m_writer.acquire(nbBytes);
+            if (p == nullptr)
+                return;
+
+            const std::uint32_t index = k;
+            const std::uint32_t stride = v.stride;
+            std::memcpy(p, &index, 4);
+            std::memcpy(p + 4, &stride, 4);
+            std::memcpy(p + 8, &m_step, 8);
+            std::memcpy(p + 16, &time, 8);
+            std::memcpy(p + 24, &count, 8);
+            char* out = p + 32;
+            if (v.stride == 1)
+                std::memcpy(out, values.data(), count * sizeof(Value));
+            else
+                for (std::uint64_t i = 0; i < count; ++i)
+                    std::memcpy(out + i * sizeof(Value), &values[i * v.stride], sizeof(Value));
+            std::memset(out + count * sizeof(Value), 0, nbBytes - 32 - count * sizeof(Value));
+            m_writer.commit();
+        };
+
+        if (v.coord)
+            recordValues(v.coord->getValue());
+        else
+            recordValues(v.deriv->getValue());
+    }
+    ++m_step;
+
+    updateStatus();
+}
+
+template <class DataTypes>
+void TrajectoryRecorder<DataTypes>::updateStatus()
+{
+    d_nbRecords.setValue((unsigned long)m_writer.getNbRecords());
+    d_nbDropped.setValue((unsigned long)m_writer.getNbDropped());
+    if (!m_failureReported && m_writer.hasFailed())
+    {
+        msg_error() << "Cannot write to file " << d_filename.getValue() << ", the next records are dropped.";
+        m_failureReported = true;
+    }
+}
+
+} // namespace nodephysics
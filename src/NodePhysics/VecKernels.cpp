@@ -0,0 +1,522 @@
+/******************************************************************************
+*       SOFA, Simulation Open-Framework Architecture, development version     *
+*                (c) 2006-2019 INRIA, USTL, UJF, CNRS, MGH                    *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#include <NodePhysics/VecKernels.h>
+
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <type_traits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#  define NODEPHYSICS_HAVE_X86_DISPATCH
+#endif
+
+// This file is compiled with -ffp-contract=off (see CMakeLists.txt): with FMA available in the
+// AVX2 and AVX-512 variants, GCC and Clang would otherwise fuse a + b*c and round differently
+// from the scalar variant.
+
+namespace nodephysics::kernels
+{
+
+namespace
+{
+
+/// Largest number of components per point handled by the vectorized bounds kernel.
+constexpr std::size_t MaxBoundsDim = 8;
+
+/// The other floating point type, converted from by the convert kernels.
+template <class T>
+using Other = typename std::conditional<std::is_same<T, float>::value, double, float>::type;
+
+/// Number of scalars of a Rigid3 coordinate: center (x,y,z) then quaternion (x,y,z,w).
+constexpr std::size_t RigidSize = 7;
+
+#if defined(__GNUC__) || defined(__clang__)
+#  define NODEPHYSICS_ALWAYS_INLINE inline __attribute__((always_inline))
+#else
+#  define NODEPHYSICS_ALWAYS_INLINE inline
+#endif
+
+/// r = s*q, with the expression of helper::Quater::operator*. P is a scalar or a pack.
+template <class P, class S>
+NODEPHYSICS_ALWAYS_INLINE void composeQuat(P* r, const S* s, const P* q)
+{
+    const P x = s[3] * q[0] + s[0] * q[3] + s[1] * q[2] - s[2] * q[1];
+    const P y = s[3] * q[1] + s[1] * q[3] + s[2] * q[0] - s[0] * q[2];
+    const P z = s[3] * q[2] + s[2] * q[3] + s[0] * q[1] - s[1] * q[0];
+    const P w = s[3] * q[3] - (s[0] * q[0] + s[1] * q[1] + s[2] * q[2]);
+    r[0] = x; r[1] = y; r[2] = z; r[3] = w;
+}
+
+/// Rotation matrix of the unit quaternion q, with the coefficients of helper::Quater::rotate.
+template <class T>
+void rotationMatrix(const T* q, T m[9])
+{
+    m[0] = T(1) - T(2) * (q[1] * q[1] + q[2] * q[2]);
+    m[1] = T(2) * (q[0] * q[1] - q[2] * q[3]);
+    m[2] = T(2) * (q[2] * q[0] + q[1] * q[3]);
+    m[3] = T(2) * (q[0] * q[1] + q[2] * q[3]);
+    m[4] = T(1) - T(2) * (q[2] * q[2] + q[0] * q[0]);
+    m[5] = T(2) * (q[1] * q[2] - q[0] * q[3]);
+    m[6] = T(2) * (q[2] * q[0] - q[1] * q[3]);
+    m[7] = T(2) * (q[1] * q[2] + q[0] * q[3]);
+    m[8] = T(1) - T(2) * (q[1] * q[1] + q[0] * q[0]);
+}
+
+/// Factor applied by helper::Quater::normalize to a quaternion of squared norm n2: 1 if the norm is
+/// already within 1e-10 of 1, or if the quaternion is null (its w is then set to 1 instead).
+template <class T>
+NODEPHYSICS_ALWAYS_INLINE T normalizeFactor(T n2)
+{
+    if (std::abs(n2 - 1.0) > 1.0e-10 && n2 != T(0))
+        return static_cast<T>(1.0 / std::sqrt(n2));
+    return T(1);
+}
+
+/// Normalizes the quaternion q as helper::Quater::normalize does.
+template <class T>
+NODEPHYSICS_ALWAYS_INLINE void normalizeQuat(T* q)
+{
+    const T n2 = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+    if (n2 == T(0))
+    {
+        q[3] = T(1);
+        return;
+    }
+    const T f = normalizeFactor(n2);
+    if (f != T(1))
+    {
+        q[0] *= f; q[1] *= f; q[2] *= f; q[3] *= f;
+    }
+}
+
+/// v.center += a.center, v.orientation = a.orientation * v.orientation
+template <class T>
+NODEPHYSICS_ALWAYS_INLINE void rigidAddBody(T* v, const T* a, bool normalize)
+{
+    v[0] += a[0]; v[1] += a[1]; v[2] += a[2];
+    composeQuat(v + 3, a + 3, v + 3);
+    if (normalize)
+        normalizeQuat(v + 3);
+}
+
+/// v.center = m * v.center, v.orientation = q * v.orientation
+template <class T>
+NODEPHYSICS_ALWAYS_INLINE void rigidRotateBody(T* v, const T* q, const T* m, bool normalize)
+{
+    const T x = v[0], y = v[1], z = v[2];
+    v[0] = m[0] * x + m[1] * y + m[2] * z;
+    v[1] = m[3] * x + m[4] * y + m[5] * z;
+    v[2] = m[6] * x + m[7] * y + m[8] * z;
+    composeQuat(v + 3, q, v + 3);
+    if (normalize)
+        normalizeQuat(v + 3);
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+
+/// Loops over packs of Bytes/sizeof(T) scalars followed by a scalar tail.
+/// The packs are GCC vector extensions, mapped on the registers of the
+/// instruction set enabled in the (target specific) calling wrapper.
+template <class T, int Bytes>
+struct Impl
+{
+    typedef T Pack __attribute__((vector_size(Bytes)));
+    static constexpr std::size_t W = Bytes / sizeof(T);
+
+    static NODEPHYSICS_ALWAYS_INLINE void load(Pack& p, const T* src) { std::memcpy(&p, src, Bytes); }
+    static NODEPHYSICS_ALWAYS_INLINE void store(T* dst, const Pack& p) { std::memcpy(dst, &p, Bytes); }
+
+    static NODEPHYSICS_ALWAYS_INLINE void zero(T* v, std::size_t n)
+    {
+        std::size_t i = 0;
+        const Pack z = {};
+        for (; i + W <= n; i += W) store(v + i, z);
+        for (; i < n; ++i) v[i] = T(0);
+    }
+
+    static NODEPHYSICS_ALWAYS_INLINE void scale(T* v, T f, std::size_t n)
+    {
+        std::size_t i = 0;
+        Pack pv;
+        for (; i + W <= n; i += W) { load(pv, v + i); pv *= f; store(v + i, pv); }
+        for (; i < n; ++i) v[i] *= f;
+    }
+
+    static NODEPHYSICS_ALWAYS_INLINE void copyScaled(T* v, const T* b, T f, std::size_t n)
+    {
+        std::size_t i = 0;
+        Pack pb;
+        for (; i + W <= n; i += W) { load(pb, b + i); pb *= f; store(v + i, pb); }
+        for (; i < n; ++i) v[i] = b[i] * f;
+    }
+
+    static NODEPHYSICS_ALWAYS_INLINE void copy(T* v, const T* a, std::size_t n)
+    {
+        if (v != a && n)
+            std::memmove(v, a, n * sizeof(T));
+    }
+
+    static NODEPHYSICS_ALWAYS_INLINE void convert(T* v, const Other<T>* a, std::size_t n)
+    {
+        typedef Other<T> O __attribute__((vector_size(W * sizeof(Other<T>))));
+        std::size_t i = 0;
+        O pa;
+        for (; i + W <= n; i += W) { std::memcpy(&pa, a + i, sizeof(O)); store(v + i, __builtin_convertvector(pa, Pack)); }
+        for (; i < n; ++i) v[i] = T(a[i]);
+    }
+
+    static NODEPHYSICS_ALWAYS_INLINE void add(T* v, const T* b, std::size_t n)
+    {
+        std::size_t i = 0;
+        Pack pv, pb;
+        for (; i + W <= n; i += W) { load(pv, v + i); load(pb, b + i); pv += pb; store(v + i, pv); }
+        for (; i < n; ++i) v[i] += b[i];
+    }
+
+    static NODEPHYSICS_ALWAYS_INLINE void addScaled(T* v, const T* b, T f, std::size_t n)
+    {
+        std::size_t i = 0;
+        Pack pv, pb;
+        for (; i + W <= n; i += W) { load(pv, v + i); load(pb, b + i); pv += pb * f; store(v + i, pv); }
+        for (; i < n; ++i) v[i] += b[i] * f;
+    }
+
+    static NODEPHYSICS_ALWAYS_INLINE void scaleAdd(T* v, const T* a, T f, std::size_t n)
+    {
+        std::size_t i = 0;
+        Pack pv, pa;
+        for (; i + W <= n; i += W) { load(pv, v + i); load(pa, a + i); pv = pv * f + pa; store(v + i, pv); }
+        for (; i < n; ++i) v[i] = v[i] * f + a[i];
+    }
+
+    static NODEPHYSICS_ALWAYS_INLINE void sum(T* v, const T* a, const T* b, std::size_t n)
+    {
+        std::size_t i = 0;
+        Pack pa, pb;
+        for (; i + W <= n; i += W) { load(pa, a + i); load(pb, b + i); pa += pb; store(v + i, pa); }
+        for (; i < n; ++i) v[i] = a[i] + b[i];
+    }
+
+    static NODEPHYSICS_ALWAYS_INLINE void sumScaled(T* v, const T* a, const T* b, T f, std::size_t n)
+    {
+        std::size_t i = 0;
+        Pack pa, pb;
+        for (; i + W <= n; i += W) { load(pa, a + i); load(pb, b + i); pa += pb * f; store(v + i, pa); }
+        for (; i < n; ++i) v[i] = a[i] + b[i] * f;
+    }
+
+    static NODEPHYSICS_ALWAYS_INLINE void bounds(const T* v, std::size_t nbPoints, std::size_t dim, T* min, T* max)
+    {
+        const std::size_t n = nbPoints * dim;
+        std::size_t i = 0;
+        if (dim <= MaxBoundsDim && n >= dim * W)
+        {
+            // blocks of W points loaded as dim packs: lane l of pack k always holds component (k*W+l)%dim
+            Pack pmin[MaxBoundsDim], pmax[MaxBoundsDim], p;
+            for (std::size_t k = 0; k < dim; ++k)
+            {
+                for (std::size_t l = 0; l < W; ++l)
+                {
+                    pmin[k][l] = min[(k * W + l) % dim];
+                    pmax[k][l] = max[(k * W + l) % dim];
+                }
+            }
+            for (; i + dim * W <= n; i += dim * W)
+            {
+                for (std::size_t k = 0; k < dim; ++k)
+                {
+                    load(p, v + i + k * W);
+                    pmin[k] = p < pmin[k] ? p : pmin[k];
+                    pmax[k] = p > pmax[k] ? p : pmax[k];
+                }
+            }
+            for (std::size_t k = 0; k < dim; ++k)
+            {
+                for (std::size_t l = 0; l < W; ++l)
+                {
+                    const std::size_t c = (k * W + l) % dim;
+                    if (pmin[k][l] < min[c]) min[c] = pmin[k][l];
+                    if (pmax[k][l] > max[c]) max[c] = pmax[k][l];
+                }
+            }
+        }
+        for (; i < n; ++i)
+        {
+            const std::size_t c = i % dim;
+            if (v[i] < min[c]) min[c] = v[i];
+            if (v[i] > max[c]) max[c] = v[i];
+        }
+    }
+
+    /// p[k] = component k of the W bodies starting at v (array of structures to packs).
+    static NODEPHYSICS_ALWAYS_INLINE void loadBodies(Pack* p, const T* v)
+    {
+        for (std::size_t l = 0; l < W; ++l)
+            for (std::size_t k = 0; k < RigidSize; ++k)
+                p[k][l] = v[l * RigidSize + k];
+    }
+
+    static NODEPHYSICS_ALWAYS_INLINE void storeBodies(T* v, const Pack* p)
+    {
+        for (std::size_t l = 0; l < W; ++l)
+            for (std::size_t k = 0; k < RigidSize; ++k)
+                v[l * RigidSize + k] = p[k][l];
+    }
+
+    static NODEPHYSICS_ALWAYS_INLINE void normalizeQuats(Pack* q)
+    {
+        const Pack n2 = q[0] * q[0] + q[1] * q[1] + q[2] * q[2] + q[3] * q[3];
+        Pack f;
+        for (std::size_t l = 0; l < W; ++l)
+        {
+            f[l] = normalizeFactor(n2[l]);
+            if (n2[l] == T(0))
+                q[3][l] = T(1);
+        }
+        q[0] *= f; q[1] *= f; q[2] *= f; q[3] *= f;
+    }
+
+    static NODEPHYSICS_ALWAYS_INLINE void rigidAdd(T* v, const T* a, std::size_t n, bool normalize)
+    {
+        std::size_t i = 0;
+        Pack pv[RigidSize], pa[RigidSize];
+        for (; i + W <= n; i += W)
+        {
+            loadBodies(pv, v + i * RigidSize);
+            loadBodies(pa, a + i * RigidSize);
+            pv[0] += pa[0]; pv[1] += pa[1]; pv[2] += pa[2];
+            composeQuat(pv + 3, pa + 3, pv + 3);
+            if (normalize)
+                normalizeQuats(pv + 3);
+            storeBodies(v + i * RigidSize, pv);
+        }
+        for (; i < n; ++i) rigidAddBody(v + i * RigidSize, a + i * RigidSize, normalize);
+    }
+
+    static NODEPHYSICS_ALWAYS_INLINE void rigidRotate(T* v, const T* q, std::size_t n, bool normalize)
+    {
+        T m[9];
+        rotationMatrix(q, m);
+        std::size_t i = 0;
+        Pack pv[RigidSize];
+        for (; i + W <= n; i += W)
+        {
+            loadBodies(pv, v + i * RigidSize);
+            const Pack x = pv[0], y = pv[1], z = pv[2];
+            pv[0] = m[0] * x + m[1] * y + m[2] * z;
+            pv[1] = m[3] * x + m[4] * y + m[5] * z;
+            pv[2] = m[6] * x + m[7] * y + m[8] * z;
+            composeQuat(pv + 3, q, pv + 3);
+            if (normalize)
+                normalizeQuats(pv + 3);
+            storeBodies(v + i * RigidSize, pv);
+        }
+        for (; i < n; ++i) rigidRotateBody(v + i * RigidSize, q, m, normalize);
+    }
+};
+
+#else // no vector extensions: plain loops, left to the compiler auto-vectorizer
+
+template <class T, int Bytes>
+struct Impl
+{
+    static void zero(T* v, std::size_t n) { for (std::size_t i = 0; i < n; ++i) v[i] = T(0); }
+    static void scale(T* v, T f, std::size_t n) { for (std::size_t i = 0; i < n; ++i) v[i] *= f; }
+    static void copyScaled(T* v, const T* b, T f, std::size_t n) { for (std::size_t i = 0; i < n; ++i) v[i] = b[i] * f; }
+    static void copy(T* v, const T* a, std::size_t n) { if (v != a && n) std::memmove(v, a, n * sizeof(T)); }
+    static void convert(T* v, const Other<T>* a, std::size_t n) { for (std::size_t i = 0; i < n; ++i) v[i] = T(a[i]); }
+    static void add(T* v, const T* b, std::size_t n) { for (std::size_t i = 0; i < n; ++i) v[i] += b[i]; }
+    static void addScaled(T* v, const T* b, T f, std::size_t n) { for (std::size_t i = 0; i < n; ++i) v[i] += b[i] * f; }
+    static void scaleAdd(T* v, const T* a, T f, std::size_t n) { for (std::size_t i = 0; i < n; ++i) v[i] = v[i] * f + a[i]; }
+    static void sum(T* v, const T* a, const T* b, std::size_t n) { for (std::size_t i = 0; i < n; ++i) v[i] = a[i] + b[i]; }
+    static void sumScaled(T* v, const T* a, const T* b, T f, std::size_t n) { for (std::size_t i = 0; i < n; ++i) v[i] = a[i] + b[i] * f; }
+    static void bounds(const T* v, std::size_t nbPoints, std::size_t dim, T* min, T* max)
+    {
+        for (std::size_t i = 0; i < nbPoints * dim; ++i)
+        {
+            if (v[i] < min[i % dim]) min[i % dim] = v[i];
+            if (v[i] > max[i % dim]) max[i % dim] = v[i];
+        }
+    }
+    static void rigidAdd(T* v, const T* a, std::size_t n, bool normalize)
+    {
+        for (std::size_t i = 0; i < n; ++i) rigidAddBody(v + i * RigidSize, a + i * RigidSize, normalize);
+    }
+    static void rigidRotate(T* v, const T* q, std::size_t n, bool normalize)
+    {
+        T m[9];
+        rotationMatrix(q, m);
+        for (std::size_t i = 0; i < n; ++i) rigidRotateBody(v + i * RigidSize, q, m, normalize);
+    }
+};
+
+#endif
+
+template <class T>
+struct KernelTable
+{
+    void (*zero)(T*, std::size_t);
+    void (*scale)(T*, T, std::size_t);
+    void (*copyScaled)(T*, const T*, T, std::size_t);
+    void (*copy)(T*, const T*, std::size_t);
+    void (*convert)(T*, const Other<T>*, std::size_t);
+    void (*add)(T*, const T*, std::size_t);
+    void (*addScaled)(T*, const T*, T, std::size_t);
+    void (*scaleAdd)(T*, const T*, T, std::size_t);
+    void (*sum)(T*, const T*, const T*, std::size_t);
+    void (*sumScaled)(T*, const T*, const T*, T, std::size_t);
+    void (*bounds)(const T*, std::size_t, std::size_t, T*, T*);
+    void (*rigidAdd)(T*, const T*, std::size_t, bool);
+    void (*rigidRotate)(T*, const T*, std::size_t, bool);
+};
+
+/// Instantiates the kernels of Impl<T,Bytes> in functions compiled for the given target.
+#define NODEPHYSICS_DEFINE_KERNELS(Name, Target, Bytes) \
+    template <class T> struct Name \
+    { \
+        Target static void zero(T* v, std::size_t n) { Impl<T,Bytes>::zero(v, n); } \
+        Target static void scale(T* v, T f, std::size_t n) { Impl<T,Bytes>::scale(v, f, n); } \
+        Target static void copyScaled(T* v, const T* b, T f, std::size_t n) { Impl<T,Bytes>::copyScaled(v, b, f, n); } \
+        Target static void copy(T* v, const T* a, std::size_t n) { Impl<T,Bytes>::copy(v, a, n); } \
+        Target static void convert(T* v, const Other<T>* a, std::size_t n) { Impl<T,Bytes>::convert(v, a, n); } \
+        Target static void add(T* v, const T* b, std::size_t n) { Impl<T,Bytes>::add(v, b, n); } \
+        Target static void addScaled(T* v, const T* b, T f, std::size_t n) { Impl<T,Bytes>::addScaled(v, b, f, n); } \
+        Target static void scaleAdd(T* v, const T* a, T f, std::size_t n) { Impl<T,Bytes>::scaleAdd(v, a, f, n); } \
+        Target static void sum(T* v, const T* a, const T* b, std::size_t n) { Impl<T,Bytes>::sum(v, a, b, n); } \
+        Target static void sumScaled(T* v, const T* a, const T* b, T f, std::size_t n) { Impl<T,Bytes>::sumScaled(v, a, b, f, n); } \
+        Target static void bounds(const T* v, std::size_t nbPoints, std::size_t dim, T* min, T* max) { Impl<T,Bytes>::bounds(v, nbPoints, dim, min, max); } \
+        Target static void rigidAdd(T* v, const T* a, std::size_t n, bool normalize) { Impl<T,Bytes>::rigidAdd(v, a, n, normalize); } \
+        Target static void rigidRotate(T* v, const T* q, std::size_t n, bool normalize) { Impl<T,Bytes>::rigidRotate(v, q, n, normalize); } \
+        static KernelTable<T> table() \
+        { \
+            return { &zero, &scale, &copyScaled, &copy, &convert, &add, &addScaled, &scaleAdd, &sum, &sumScaled, &bounds, &rigidAdd, &rigidRotate }; \
+        } \
+    };
+
+NODEPHYSICS_DEFINE_KERNELS(ScalarKernels, , 16)
+#ifdef NODEPHYSICS_HAVE_X86_DISPATCH
+NODEPHYSICS_DEFINE_KERNELS(Avx2Kernels, __attribute__((target("avx2"))), 32)
+NODEPHYSICS_DEFINE_KERNELS(Avx512Kernels, __attribute__((target("avx512f"))), 64)
+#endif
+
+#undef NODEPHYSICS_DEFINE_KERNELS
+
+InstructionSet detectInstructionSet()
+{
+    InstructionSet isa = InstructionSet::Scalar;
+#ifdef NODEPHYSICS_HAVE_X86_DISPATCH
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f"))
+        isa = InstructionSet::AVX512;
+    else if (__builtin_cpu_supports("avx2"))
+        isa = InstructionSet::AVX2;
+#endif
+
+    // Allow forcing a lower instruction set, e.g. to compare against the scalar path.
+    if (const char* env = std::getenv("NODEPHYSICS_SIMD"))
+    {
+        const std::string requested(env);
+        if (requested == "scalar")
+            isa = InstructionSet::Scalar;
+        else if (requested == "avx2" && isa == InstructionSet::AVX512)
+            isa = InstructionSet::AVX2;
+    }
+    return isa;
+}
+
+template <class T>
+const KernelTable<T>& getTable()
+{
+    static const KernelTable<T> table = []()
+    {
+        switch (getInstructionSet())
+        {
+#ifdef NODEPHYSICS_HAVE_X86_DISPATCH
+        case InstructionSet::AVX512: return Avx512Kernels<T>::table();
+        case InstructionSet::AVX2: return Avx2Kernels<T>::table();
+#endif
+        default: return ScalarKernels<T>::table();
+        }
+    }();
+    return table;
+}
+
+} // anonymous namespace
+
+InstructionSet getInstructionSet()
+{
+    static const InstructionSet isa = detectInstructionSet();
+    return isa;
+}
+
+const char* getInstructionSetName(InstructionSet isa)
+{
+    switch (isa)
+    {
+    case InstructionSet::AVX512: return "AVX-512";
+    case InstructionSet::AVX2: return "AVX2";
+    default: return "scalar";
+    }
+}
+
+void zero(double* v, std::size_t n) { getTable<double>().zero(v, n); }
+void zero(float* v, std::size_t n) { getTable<float>().zero(v, n); }
+
+void scale(double* v, double f, std::size_t n) { getTable<double>().scale(v, f, n); }
+void scale(float* v, float f, std::size_t n) { getTable<float>().scale(v, f, n); }
+
+void copyScaled(double* v, const double* b, double f, std::size_t n) { getTable<double>().copyScaled(v, b, f, n); }
+void copyScaled(float* v, const float* b, float f, std::size_t n) { getTable<float>().copyScaled(v, b, f, n); }
+
+void copy(double* v, const double* a, std::size_t n) { getTable<double>().copy(v, a, n); }
+void copy(float* v, const float* a, std::size_t n) { getTable<float>().copy(v, a, n); }
+
+void convert(double* v, const float* a, std::size_t n) { getTable<double>().convert(v, a, n); }
+void convert(float* v, const double* a, std::size_t n) { getTable<float>().convert(v, a, n); }
+
+void add(double* v, const double* b, std::size_t n) { getTable<double>().add(v, b, n); }
+void add(float* v, const float* b, std::size_t n) { getTable<float>().add(v, b, n); }
+
+void addScaled(double* v, const double* b, double f, std::size_t n) { getTable<double>().addScaled(v, b, f, n); }
+void addScaled(float* v, const float* b, float f, std::size_t n) { getTable<float>().addScaled(v, b, f, n); }
+
+void scaleAdd(double* v, const double* a, double f, std::size_t n) { getTable<double>().scaleAdd(v, a, f, n); }
+void scaleAdd(float* v, const float* a, float f, std::size_t n) { getTable<float>().scaleAdd(v, a, f, n); }
+
+void sum(double* v, const double* a, const double* b, std::size_t n) { getTable<double>().sum(v, a, b, n); }
+void sum(float* v, const float* a, const float* b, std::size_t n) { getTable<float>().sum(v, a, b, n); }
+
+void sumScaled(double* v, const double* a, const double* b, double f, std::size_t n) { getTable<double>().sumScaled(v, a, b, f, n); }
+void sumScaled(float* v, const float* a, const float* b, float f, std::size_t n) { getTable<float>().sumScaled(v, a, b, f, n); }
+
+void bounds(const double* v, std::size_t nbPoints, std::size_t dim, double* min, double* max) { getTable<double>().bounds(v, nbPoints, dim, min, max); }
+void bounds(const float* v, std::size_t nbPoints, std::size_t dim, float* min, float* max) { getTable<float>().bounds(v, nbPoints, dim, min, max); }
+
+void rigidAdd(double* v, const double* a, std::size_t n, bool normalize) { getTable<double>().rigidAdd(v, a, n, normalize); }
+void rigidAdd(float* v, const float* a, std::size_t n, bool normalize) { getTable<float>().rigidAdd(v, a, n, normalize); }
+
+void rigidRotate(double* v, const double* q, std::size_t n, bool normalize) { getTable<double>().rigidRotate(v, q, n, normalize); }
+void rigidRotate(float* v, const float* q, std::size_t n, bool normalize) { getTable<float>().rigidRotate(v, q, n, normalize); }
+
+} // namespace nodephysics::kernels
@@ -0,0 +1,110 @@
+/******************************************************************************
+*       SOFA, Simulation Open-Framework Architecture, development version     *
+*                (c) 2006-2019 INRIA, USTL, UJF, CNRS, MGH                    *
+*                                                                             *
+* This program is free software; you can redistribute it and/or modify it     *
+* under the terms of the GNU Lesser General Public License as published by    *
+* the Free Software Foundation; either version 2.1 of the License, or (at     *
+* your option) any later version.                                             *
+*                                                                             *
+* This program is distributed in the hope that it will be useful, but WITHOUT *
+* ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or       *
+* FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License *
+* for more details.                                                           *
+*                                                                             *
+* You should have received a copy of the GNU Lesser General Public License    *
+* along with this program. If not, see <http://www.gnu.org/licenses/>.        *
+*******************************************************************************
+* Authors: The SOFA Team and external contributors (see Authors.txt)          *
+*                                                                             *
+* Contact information: contact@sofa-framework.org                             *
+******************************************************************************/
+#pragma once
+
+#include <NodePhysics/config.h>
+
+#include <cstddef>
+
+/**
+ * Kernels operating on flat arrays of scalars, used by MechanicalObject when
+ * its Coord and Deriv types are plain arrays of Real (Vec1/2/3/6 types), and
+ * for the rigid updates of Rigid3 types.
+ *
+ * The implementation is selected once at runtime from the instruction sets
+ * reported by the CPU (AVX-512, AVX2, or a portable scalar fallback). The
+ * NODEPHYSICS_SIMD environment variable ("scalar", "avx2", "avx512") can be
+ * used to force a lower instruction set.
+ *
+ * All kernels accept aliased arguments (e.g. v == a).
+ */
+namespace nodephysics::kernels
+{
+
+enum class InstructionSet
+{
+    Scalar,
+    AVX2,
+    AVX512
+};
+
+/// Instruction set used by the kernels.
+SOFA_NODEPHYSICS_API InstructionSet getInstructionSet();
+SOFA_NODEPHYSICS_API const char* getInstructionSetName(InstructionSet isa);
+
+/// v = 0
+SOFA_NODEPHYSICS_API void zero(double* v, std::size_t n);
+SOFA_NODEPHYSICS_API void zero(float* v, std::size_t n);
+
+/// v *= f
+SOFA_NODEPHYSICS_API void scale(double* v, double f, std::size_t n);
+SOFA_NODEPHYSICS_API void scale(float* v, float f, std::size_t n);
+
+/// v = b*f
+SOFA_NODEPHYSICS_API void copyScaled(double* v, const double* b, double f, std::size_t n);
+SOFA_NODEPHYSICS_API void copyScaled(float* v, const float* b, float f, std::size_t n);
+
+/// v = a
+SOFA_NODEPHYSICS_API void copy(double* v, const double* a, std::size_t n);
+SOFA_NODEPHYSICS_API void copy(float* v, const float* a, std::size_t n);
+
+/// v = a, converted to the type of v
+SOFA_NODEPHYSICS_API void convert(double* v, const float* a, std::size_t n);
+SOFA_NODEPHYSICS_API void convert(float* v, const double* a, std::size_t n);
+
+/// v += b
+SOFA_NODEPHYSICS_API void add(double* v, const double* b, std::size_t n);
+SOFA_NODEPHYSICS_API void add(float* v, const float* b, std::size_t n);
+
+/// v += b*f
+SOFA_NODEPHYSICS_API void addScaled(double* v, const double* b, double f, std::size_t n);
+SOFA_NODEPHYSICS_API void addScaled(float* v, const float* b, float f, std::size_t n);
+
+/// v = a + v*f
+SOFA_NODEPHYSICS_API void scaleAdd(double* v, const double* a, double f, std::size_t n);
+SOFA_NODEPHYSICS_API void scaleAdd(float* v, const float* a, float f, std::size_t n);
+
+/// v = a + b
+SOFA_NODEPHYSICS_API void sum(double* v, const double* a, const double* b, std::size_t n);
+SOFA_NODEPHYSICS_API void sum(float* v, const float* a, const float* b, std::size_t n);
+
+/// v = a + b*f
+SOFA_NODEPHYSICS_API void sumScaled(double* v, const double* a, const double* b, double f, std::size_t n);
+SOFA_NODEPHYSICS_API void sumScaled(float* v, const float* a, const float* b, float f, std::size_t n);
+
+/// min[c] = min(min[c], v[i*dim+c]), max[c] = max(max[c], v[i*dim+c]) for the nbPoints points of dim components.
+/// NaN values are ignored.
+SOFA_NODEPHYSICS_API void bounds(const double* v, std::size_t nbPoints, std::size_t dim, double* min, double* max);
+SOFA_NODEPHYSICS_API void bounds(const float* v, std::size_t nbPoints, std::size_t dim, float* min, float* max);
+
+/// Rigid3 kernels, on n bodies of 7 scalars: center (x,y,z) then orientation quaternion (x,y,z,w).
+/// If normalize is set, the resulting orientations are scaled back to unit length.
+
+/// v.center += a.center, v.orientation = a.orientation * v.orientation
+SOFA_NODEPHYSICS_API void rigidAdd(double* v, const double* a, std::size_t n, bool normalize);
+SOFA_NODEPHYSICS_API void rigidAdd(float* v, const float* a, std::size_t n, bool normalize);
+
+/// v.center = q.rotate(v.center), v.orientation = q * v.orientation, for the unit quaternion q[4]
+SOFA_NODEPHYSICS_API void rigidRotate(double* v, const double* q, std::size_t n, bool normalize);
+SOFA_NODEPHYSICS_API void rigidRotate(float* v, const float* q, std::size_t n, bool normalize);
+
+} // namespace nodephysics::kernels
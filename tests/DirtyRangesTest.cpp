@@ -0,0 +1,56 @@
+#include <vector>
+
+#include <SofaTest/Sofa_test.h>
+
+#include <NodePhysics/DirtyRanges.h>
+
+namespace nodephysics::test
+{
+
+typedef std::vector<DirtyRanges::Range> Ranges;
+
+struct DirtyRanges_test : public sofa::helper::testing::BaseTest
+{
+    DirtyRanges ranges;
+};
+
+/// Indices added in increasing order extend the last range when they touch it.
+TEST_F(DirtyRanges_test, mergesConsecutiveIndices)
+{
+    for (std::size_t i = 3; i < 10; ++i)
+        ranges.add(i, i + 1);
+    ranges.add(12, 14);
+    ranges.add(13, 15);
+    ranges.add(5, 5); // empty
+    EXPECT_EQ(ranges.getRanges(), Ranges({{3, 10}, {12, 15}}));
+    EXPECT_EQ(ranges.getNbIndices(), 10u);
+}
+
+/// Ranges added out of order are inserted in place, and merged with all the ranges they overlap or touch.
+TEST_F(DirtyRanges_test, mergesOutOfOrderRanges)
+{
+    ranges.add(20, 22);
+    ranges.add(10, 12);
+    ranges.add(0, 2);
+    ranges.add(30, 32);
+    EXPECT_EQ(ranges.getRanges(), Ranges({{0, 2}, {10, 12}, {20, 22}, {30, 32}}));
+
+    ranges.add(5, 6);
+    EXPECT_EQ(ranges.getRanges(), Ranges({{0, 2}, {5, 6}, {10, 12}, {20, 22}, {30, 32}}));
+
+    // touches [5,6) and overlaps [10,12) and [20,22)
+    ranges.add(6, 21);
+    EXPECT_EQ(ranges.getRanges(), Ranges({{0, 2}, {5, 22}, {30, 32}}));
+
+    ranges.add(2, 3);
+    EXPECT_EQ(ranges.getRanges(), Ranges({{0, 3}, {5, 22}, {30, 32}}));
+
+    ranges.add(0, 40);
+    EXPECT_EQ(ranges.getRanges(), Ranges({{0, 40}}));
+
+    ranges.clear();
+    EXPECT_TRUE(ranges.empty());
+    EXPECT_EQ(ranges.getNbIndices(), 0u);
+}
+
+}  // namespace nodephysics::test
@@ -0,0 +1,659 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <list>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <SofaTest/Sofa_test.h>
+#include <SofaTest/TestMessageHandler.h>
+#include <SofaBaseLinearSolver/FullMatrix.h>
+#include <sofa/core/ConstraintParams.h>
+#include <sofa/core/ExecParams.h>
+#include <sofa/core/MultiVecId.h>
+#include <sofa/defaulttype/RigidTypes.h>
+#include <sofa/defaulttype/VecTypes.h>
+
+#include <NodePhysics/MechanicalObject.h>
+
+namespace nodephysics::test
+{
+
+using sofa::defaulttype::Vec3Types;
+using sofa::defaulttype::Rigid3Types;
+using sofa::helper::vector;
+
+/// Values of the state vectors set by the tests, with a fixed seed.
+template <class DataTypes>
+struct RandomValues;
+
+template <>
+struct RandomValues<Vec3Types>
+{
+    static void fill(Vec3Types::VecCoord& x, std::mt19937& g)
+    {
+        std::uniform_real_distribution<double> d(-10.0, 10.0);
+        for (Vec3Types::Coord& c : x)
+            c = Vec3Types::Coord(d(g), d(g), d(g));
+    }
+};
+
+template <>
+struct RandomValues<Rigid3Types>
+{
+    static void fill(Rigid3Types::VecCoord& x, std::mt19937& g)
+    {
+        std::uniform_real_distribution<double> d(-1.0, 1.0);
+        for (Rigid3Types::Coord& c : x)
+        {
+            Rigid3Types::Rot q(d(g), d(g), d(g), d(g));
+            q.normalize();
+            c = Rigid3Types::Coord(Rigid3Types::CPos(d(g), d(g), d(g)), q);
+        }
+    }
+};
+
+/// A MechanicalObject with random positions, and velocities computed from them.
+template <class DataTypes>
+struct State
+{
+    typedef MechanicalObject<DataTypes> MO;
+    typedef typename DataTypes::VecCoord VecCoord;
+    typedef typename DataTypes::VecDeriv VecDeriv;
+
+    typename MO::SPtr mo;
+
+    State(std::size_t n, std::mt19937& generator)
+        : mo(sofa::core::objectmodel::New<MO>())
+    {
+        mo->resize(n);
+        {
+            sofa::helper::WriteAccessor< Data<VecCoord> > x = mo->writePositions();
+            RandomValues<DataTypes>::fill(x.wref(), generator);
+        }
+        {
+            sofa::helper::WriteAccessor< Data<VecDeriv> > v = mo->writeVelocities();
+            const VecCoord& x = mo->readPositions().ref();
+            for (std::size_t i = 0; i < v.size(); ++i)
+                v[i] = DataTypes::coordDifference(x[(i + 1) % n], x[i]);
+        }
+    }
+
+    VecCoord positions() const { return mo->readPositions().ref(); }
+    VecDeriv velocities() const { return mo->readVelocities().ref(); }
+    VecDeriv forces() const { return mo->read(sofa::core::ConstVecDerivId::force())->getValue(); }
+};
+
+template <class DataTypes>
+struct MechanicalObject_test : public sofa::helper::testing::BaseTest
+{
+    typedef typename State<DataTypes>::MO MO;
+    typedef typename DataTypes::VecCoord VecCoord;
+    typedef typename DataTypes::VecDeriv VecDeriv;
+
+    std::mt19937 generator {42};
+};
+
+typedef MechanicalObject_test<Vec3Types> MechanicalObjectVec3_test;
+typedef MechanicalObject_test<Rigid3Types> MechanicalObjectRigid3_test;
+
+
+const sofa::core::ExecParams* params()
+{
+    return sofa::core::ExecParams::defaultInstance();
+}
+
+/// Constraint lines 0: DOFs 1 and 3, 2: DOF 0, 5: DOF 2 and 3.
+template <class MO>
+void setConstraintJacobian(MO& mo)
+{
+    typedef typename MO::Deriv Deriv;
+    typename MO::MatrixDeriv& c = *mo.write(sofa::core::MatrixDerivId::constraintJacobian())->beginEdit();
+    c.clear();
+    c.writeLine(0).addCol(1, Deriv(1, 2, 3));
+    c.writeLine(0).addCol(3, Deriv(-1, 0.5, 4));
+    c.writeLine(2).addCol(0, Deriv(0.25, -2, 1));
+    c.writeLine(5).addCol(3, Deriv(2, 2, -3));
+    c.writeLine(5).addCol(2, Deriv(-0.5, 1, 8));
+    mo.write(sofa::core::MatrixDerivId::constraintJacobian())->endEdit();
+}
+
+/// computeWeightedValues on Rigid3 states gives the result of Rigid3Types::interpolate, and the same
+/// result as successive computeWeightedValue calls.
+TEST_F(MechanicalObjectRigid3_test, computeWeightedValuesInterpolatesRigids)
+{
+    State<Rigid3Types> state(6, generator);
+    const vector<unsigned int> indices {4, 5};
+    const vector<unsigned int> offsets {0, 3, 5};
+    const vector<unsigned int> ancestors {0, 1, 2, 1, 3};
+    const vector<double> coefs {0.2, 0.3, 0.5, 0.75, 0.25};
+
+    const VecCoord x0 = state.positions();
+    const VecDeriv v0 = state.velocities();
+
+    State<Rigid3Types> sequential(6, generator);
+    sequential.mo->writePositions().wref() = x0;
+    sequential.mo->writeVelocities().wref() = v0;
+
+    state.mo->computeWeightedValues(indices, offsets, ancestors, coefs);
+    for (std::size_t p = 0; p < indices.size(); ++p)
+    {
+        const vector<unsigned int> a(ancestors.begin() + offsets[p], ancestors.begin() + offsets[p + 1]);
+        const vector<double> c(coefs.begin() + offsets[p], coefs.begin() + offsets[p + 1]);
+        sequential.mo->computeWeightedValue(indices[p], a, c);
+
+        vector<Rigid3Types::Coord> ancestorsX;
+        vector<Rigid3Types::Deriv> ancestorsV;
+        vector<Rigid3Types::Real> ancestorsCoefs;
+        for (std::size_t k = 0; k < a.size(); ++k)
+        {
+            ancestorsX.push_back(x0[a[k]]);
+            ancestorsV.push_back(v0[a[k]]);
+            ancestorsCoefs.push_back((Rigid3Types::Real)c[k]);
+        }
+        const Rigid3Types::Coord expectedX = Rigid3Types::interpolate(ancestorsX, ancestorsCoefs);
+        const Rigid3Types::Deriv expectedV = Rigid3Types::interpolate(ancestorsV, ancestorsCoefs);
+
+        const Rigid3Types::Coord x = state.positions()[indices[p]];
+        const Rigid3Types::Deriv v = state.velocities()[indices[p]];
+        for (std::size_t j = 0; j < 3; ++j)
+        {
+            EXPECT_DOUBLE_EQ(x.getCenter()[j], expectedX.getCenter()[j]);
+            EXPECT_DOUBLE_EQ(v.getVCenter()[j], expectedV.getVCenter()[j]);
+            EXPECT_DOUBLE_EQ(v.getVOrientation()[j], expectedV.getVOrientation()[j]);
+        }
+        for (std::size_t j = 0; j < 4; ++j)
+            EXPECT_DOUBLE_EQ(x.getOrientation()[j], expectedX.getOrientation()[j]);
+    }
+
+    EXPECT_EQ(state.positions(), sequential.positions());
+    EXPECT_EQ(state.velocities(), sequential.velocities());
+}
+
+/// removeValues with duplicated indices gives the result of successive replaceValue(last, index) calls.
+TEST_F(MechanicalObjectVec3_test, removeValuesWithDuplicates)
+{
+    State<Vec3Types> state(10, generator);
+    const vector<unsigned int> indices {2, 7, 2, 9, 0};
+
+    VecCoord expected = state.positions();
+    for (std::size_t i = 0; i < indices.size(); ++i)
+        expected[indices[i]] = expected[expected.size() - 1 - i];
+    expected.resize(expected.size() - indices.size());
+
+    state.mo->removeValues(indices);
+    EXPECT_EQ(state.mo->getSize(), expected.size());
+    EXPECT_EQ(state.positions(), expected);
+}
+
+/// renumberValues falls back to copies when the index is not a permutation.
+TEST_F(MechanicalObjectVec3_test, renumberValuesNotAPermutation)
+{
+    State<Vec3Types> state(5, generator);
+    const vector<unsigned int> index {1, 1, 4, 0, 4};
+
+    const VecCoord x0 = state.positions();
+    const VecDeriv v0 = state.velocities();
+
+    state.mo->renumberValues(index);
+    for (std::size_t i = 0; i < index.size(); ++i)
+    {
+        EXPECT_EQ(state.positions()[i], x0[index[i]]) << "value " << i;
+        EXPECT_EQ(state.velocities()[i], v0[index[i]]) << "value " << i;
+    }
+}
+
+/// renumberValues permutes the values in place when the index is a permutation.
+TEST_F(MechanicalObjectVec3_test, renumberValuesPermutation)
+{
+    State<Vec3Types> state(6, generator);
+    const vector<unsigned int> index {3, 0, 1, 2, 5, 4};
+
+    const VecCoord x0 = state.positions();
+    state.mo->renumberValues(index);
+    for (std::size_t i = 0; i < index.size(); ++i)
+        EXPECT_EQ(state.positions()[i], x0[index[i]]) << "value " << i;
+}
+
+/// vOp gives the result of the scalar loops, with and without parallelism.
+TEST_F(MechanicalObjectVec3_test, vOpMatchesScalarReference)
+{
+    using sofa::core::VecCoordId;
+    using sofa::core::VecDerivId;
+    using sofa::core::ConstVecId;
+
+    for (int grain : {0, 64})
+    {
+        State<Vec3Types> state(1001, generator);
+        state.mo->d_parallelGrainSize.setValue(grain);
+        const double f = 0.37;
+
+        const VecCoord x0 = state.positions();
+        const VecDeriv v0 = state.velocities();
+
+        // force = velocity * f
+        VecDeriv expected(v0.size());
+        for (std::size_t i = 0; i < v0.size(); ++i)
+            expected[i] = v0[i] * f;
+        state.mo->vOp(params(), VecDerivId::force(), ConstVecId::null(), VecDerivId::velocity(), f);
+        EXPECT_EQ(state.forces(), expected);
+
+        // force = velocity + force * f
+        for (std::size_t i = 0; i < v0.size(); ++i)
+            expected[i] = v0[i] + expected[i] * f;
+        state.mo->vOp(params(), VecDerivId::force(), VecDerivId::velocity(), VecDerivId::force(), f);
+        EXPECT_EQ(state.forces(), expected);
+
+        // position = position + velocity * f
+        VecCoord expectedX(x0.size());
+        for (std::size_t i = 0; i < x0.size(); ++i)
+            expectedX[i] = x0[i] + v0[i] * f;
+        state.mo->vOp(params(), VecCoordId::position(), VecCoordId::position(), VecDerivId::velocity(), f);
+        EXPECT_EQ(state.positions(), expectedX);
+
+        // velocity = 0
+        state.mo->vOp(params(), VecDerivId::velocity());
+        EXPECT_EQ(state.velocities(), VecDeriv(v0.size(), Vec3Types::Deriv()));
+    }
+}
+
+/// vMultiOp gives the result of the successive scalar loops, each operation seeing the
+/// results of the previous ones.
+TEST_F(MechanicalObjectVec3_test, vMultiOpMatchesScalarReference)
+{
+    using sofa::core::VecCoordId;
+    using sofa::core::VecDerivId;
+    using sofa::core::MultiVecId;
+    using sofa::core::ConstMultiVecId;
+
+    for (int grain : {0, 64})
+    {
+        State<Vec3Types> state(1001, generator);
+        state.mo->d_parallelGrainSize.setValue(grain);
+        const double dt = 0.01;
+        state.mo->vOp(params(), VecDerivId::force(), sofa::core::ConstVecId::null(), VecDerivId::velocity(), -2.0);
+
+        const VecCoord x0 = state.positions();
+        const VecDeriv v0 = state.velocities();
+        const VecDeriv f0 = state.forces();
+
+        // velocity = velocity + force * dt, then position = position + velocity * dt
+        MO::VMultiOp ops(2);
+        ops[0].first = MultiVecId(VecDerivId::velocity());
+        ops[0].second.push_back(std::make_pair(ConstMultiVecId(VecDerivId::velocity()), 1.0));
+        ops[0].second.push_back(std::make_pair(ConstMultiVecId(VecDerivId::force()), dt));
+        ops[1].first = MultiVecId(VecCoordId::position());
+        ops[1].second.push_back(std::make_pair(ConstMultiVecId(VecCoordId::position()), 1.0));
+        ops[1].second.push_back(std::make_pair(ConstMultiVecId(VecDerivId::velocity()), dt));
+        state.mo->vMultiOp(params(), ops);
+
+        VecDeriv expectedV(v0.size());
+        VecCoord expectedX(x0.size());
+        for (std::size_t i = 0; i < v0.size(); ++i)
+        {
+            expectedV[i] = v0[i] + f0[i] * dt;
+            expectedX[i] = x0[i] + expectedV[i] * dt;
+        }
+        EXPECT_EQ(state.velocities(), expectedV);
+        EXPECT_EQ(state.positions(), expectedX);
+    }
+}
+
+/// By default vDot keeps the sequential summation of the DOF dot products, and with parallel loops
+/// the deterministic mode gives the result of one thread.
+TEST_F(MechanicalObjectVec3_test, vDotSummation)
+{
+    using sofa::core::VecDerivId;
+
+    State<Vec3Types> state(20001, generator);
+    const VecDeriv v0 = state.velocities();
+    double expected = 0.0;
+    for (std::size_t i = 0; i < v0.size(); ++i)
+        expected += v0[i] * v0[i];
+    EXPECT_EQ(state.mo->vDot(params(), VecDerivId::velocity(), VecDerivId::velocity()), expected);
+
+    state.mo->d_deterministicReductions.setValue(true);
+    const SReal sequential = state.mo->vDot(params(), VecDerivId::velocity(), VecDerivId::velocity());
+    state.mo->d_parallelGrainSize.setValue(64);
+    EXPECT_EQ(state.mo->vDot(params(), VecDerivId::velocity(), VecDerivId::velocity()), sequential);
+}
+
+/// A checkpoint restores the size and the vectors of the state it was written from.
+TEST_F(MechanicalObjectVec3_test, checkpointRoundTrip)
+{
+    const std::string filename = "MechanicalObjectTest_checkpoint.bin";
+    State<Vec3Types> state(257, generator);
+    ASSERT_TRUE(state.mo->writeCheckpoint(filename));
+
+    State<Vec3Types> restored(3, generator);
+    ASSERT_TRUE(restored.mo->readCheckpoint(filename));
+    EXPECT_EQ(restored.mo->getSize(), state.mo->getSize());
+    EXPECT_EQ(restored.positions(), state.positions());
+    EXPECT_EQ(restored.velocities(), state.velocities());
+
+    std::remove(filename.c_str());
+}
+
+/// A truncated checkpoint is rejected without resizing the state.
+TEST_F(MechanicalObjectVec3_test, checkpointTruncated)
+{
+    const std::string filename = "MechanicalObjectTest_truncated.bin";
+    State<Vec3Types> state(257, generator);
+    ASSERT_TRUE(state.mo->writeCheckpoint(filename));
+    {
+        std::ifstream in(filename, std::ios::binary);
+        std::vector<char> content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        out.write(content.data(), 64);
+    }
+
+    State<Vec3Types> restored(3, generator);
+    {
+        EXPECT_MSG_EMIT(Error);
+        EXPECT_FALSE(restored.mo->readCheckpoint(filename));
+    }
+    EXPECT_EQ(restored.mo->getSize(), 3u);
+
+    std::remove(filename.c_str());
+}
+
+/// A checkpoint truncated inside its second vector is rejected without changing the state: all the
+/// records are validated before the first one is copied.
+TEST_F(MechanicalObjectVec3_test, checkpointTruncatedInSecondVector)
+{
+    const std::string filename = "MechanicalObjectTest_truncatedVector.bin";
+    State<Vec3Types> state(257, generator);
+    ASSERT_TRUE(state.mo->writeCheckpoint(filename));
+    {
+        std::ifstream in(filename, std::ios::binary);
+        std::vector<char> content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+        in.close();
+
+        // the positions are the first vector: cut in the middle of the values of the next one
+        const VecCoord& x = state.mo->readPositions().ref();
+        const char* xBegin = reinterpret_cast<const char*>(x.data());
+        const char* xEnd = xBegin + x.size() * sizeof(Vec3Types::Coord);
+        const auto position = std::search(content.begin(), content.end(), xBegin, xEnd);
+        ASSERT_NE(position, content.end());
+        const std::size_t secondRecord = (std::size_t)(position - content.begin()) + (std::size_t)(xEnd - xBegin);
+        const std::size_t cut = secondRecord + 16 + 100;
+        ASSERT_LT(cut, content.size());
+
+        std::ofstream out(filename, std::ios::binary | std::ios::trunc);
+        out.write(content.data(), cut);
+    }
+
+    State<Vec3Types> restored(3, generator);
+    const VecCoord x0 = restored.positions();
+    const VecDeriv v0 = restored.velocities();
+    {
+        EXPECT_MSG_EMIT(Error);
+        EXPECT_FALSE(restored.mo->readCheckpoint(filename));
+    }
+    EXPECT_EQ(restored.mo->getSize(), 3u);
+    EXPECT_EQ(restored.positions(), x0);
+    EXPECT_EQ(restored.velocities(), v0);
+
+    std::remove(filename.c_str());
+}
+
+/// compareVec reports no error against the output of writeVec for the same state.
+TEST_F(MechanicalObjectVec3_test, compareVecWithWrittenState)
+{
+    using sofa::core::VecCoordId;
+    using sofa::core::VecDerivId;
+
+    State<Vec3Types> state(100, generator);
+    std::ostringstream out;
+    state.mo->writeVec(VecCoordId::position(), out);
+    out << "\n";
+    state.mo->writeVec(VecDerivId::velocity(), out);
+    out << "\n";
+
+    std::istringstream in(out.str());
+    EXPECT_EQ(state.mo->compareVec(VecCoordId::position(), in), 0.0);
+    EXPECT_EQ(state.mo->compareVec(VecDerivId::velocity(), in), 0.0);
+}
+
+/// In sparse mode resetForce only zeroes the DOFs declared during the step and the previous one.
+TEST_F(MechanicalObjectVec3_test, sparseForceReset)
+{
+    using sofa::core::VecDerivId;
+    using sofa::core::ConstVecId;
+
+    State<Vec3Types> state(100, generator);
+    MO& mo = *state.mo;
+    mo.d_sparseForces.setValue(true);
+    mo.forceMask.assign(mo.getSize(), false);
+    mo.forceMask.activate(true);
+
+    // the first reset is a full one
+    mo.vOp(params(), VecDerivId::force(), ConstVecId::null(), VecDerivId::velocity(), 1.0);
+    mo.resetForce(params(), VecDerivId::force());
+    EXPECT_EQ(state.forces(), VecDeriv(100, Vec3Types::Deriv()));
+
+    // step 1: forces on DOFs 3 (declared) and 7 (external force)
+    mo.insertForceMaskEntry(3);
+    mo.addExternalForce(7, Vec3Types::Deriv(1, 2, 3));
+    mo.accumulateForce(params(), VecDerivId::force());
+    mo.vOp(params(), VecDerivId::force(), ConstVecId::null(), VecDerivId::velocity(), 1.0);
+    const VecDeriv f1 = state.forces();
+    mo.resetForce(params(), VecDerivId::force());
+    for (std::size_t i = 0; i < f1.size(); ++i)
+        EXPECT_EQ(state.forces()[i], (i == 3 || i == 7) ? Vec3Types::Deriv() : f1[i]) << "DOF " << i;
+    mo.endIntegration(params(), 0.01);
+
+    // step 2: the DOFs of step 1 are still reset, along with the new ones
+    mo.beginIntegration(0.01);
+    mo.forceMask.activate(true);
+    mo.vOp(params(), VecDerivId::force(), ConstVecId::null(), VecDerivId::velocity(), 1.0);
+    mo.insertForceMaskEntry(12);
+    const VecDeriv f2 = state.forces();
+    mo.resetForce(params(), VecDerivId::force());
+    for (std::size_t i = 0; i < f2.size(); ++i)
+        EXPECT_EQ(state.forces()[i], (i == 3 || i == 7 || i == 12) ? Vec3Types::Deriv() : f2[i]) << "DOF " << i;
+}
+
+/// A dense matrix which counts the calls to add.
+struct CountingFullMatrix : public sofa::component::linearsolver::FullMatrix<SReal>
+{
+    unsigned int nbAdd {0};
+
+    CountingFullMatrix(Index nbRow, Index nbCol) : sofa::component::linearsolver::FullMatrix<SReal>(nbRow, nbCol) {}
+
+    void add(Index i, Index j, double v) override
+    {
+        ++nbAdd;
+        sofa::component::linearsolver::FullMatrix<SReal>::add(i, j, v);
+    }
+};
+
+/// The constraint Jacobian exported to a FullMatrix, to a matrix deriving from it (through add) and in
+/// CSR layout holds the same entries.
+TEST_F(MechanicalObjectVec3_test, getConstraintJacobianExports)
+{
+    State<Vec3Types> state(4, generator);
+    setConstraintJacobian(*state.mo);
+    sofa::core::ConstraintParams cParams;
+
+    sofa::component::linearsolver::FullMatrix<SReal> dense(6, 3 + 12);
+    dense.clear();
+    unsigned int off = 3;
+    state.mo->getConstraintJacobian(&cParams, &dense, off);
+    EXPECT_EQ(off, 15u);
+
+    CountingFullMatrix counted(6, 3 + 12);
+    counted.clear();
+    off = 3;
+    state.mo->getConstraintJacobian(&cParams, &counted, off);
+    EXPECT_EQ(off, 15u);
+    EXPECT_EQ(counted.nbAdd, 5u * 3);
+
+    for (int i = 0; i < 6; ++i)
+        for (int j = 0; j < 15; ++j)
+            EXPECT_EQ(counted.element(i, j), dense.element(i, j)) << "(" << i << ", " << j << ")";
+    EXPECT_EQ(dense.element(0, 3 + 3 + 1), 2.0);
+    EXPECT_EQ(dense.element(5, 3 + 9 + 2), -3.0);
+
+    MO::ConstraintJacobianCSR csr;
+    state.mo->getConstraintJacobian(&cParams, csr, 3);
+    ASSERT_EQ(csr.rowIndices, vector<int>({0, 2, 5}));
+    ASSERT_EQ(csr.rowBegin, vector<int>({0, 6, 9, 15}));
+    ASSERT_EQ(csr.values.size(), 15u);
+    for (std::size_t r = 0; r < csr.rowIndices.size(); ++r)
+        for (int k = csr.rowBegin[r]; k < csr.rowBegin[r + 1]; ++k)
+            EXPECT_EQ(csr.values[k], dense.element(csr.rowIndices[r], csr.colIndices[k]));
+    EXPECT_TRUE(std::is_sorted(csr.colIndices.begin() + csr.rowBegin[2], csr.colIndices.end()));
+}
+
+/// getConstraintBlocks gives the blocks of constraintBlocks, also when its arrays are reused.
+TEST_F(MechanicalObjectVec3_test, getConstraintBlocksMatchesConstraintBlocks)
+{
+    State<Vec3Types> state(4, generator);
+    setConstraintJacobian(*state.mo);
+
+    // line 7 does not exist
+    const std::list<unsigned int> indices {5, 0, 7, 2};
+    std::list<MO::ConstraintBlock> reference = state.mo->constraintBlocks(indices);
+
+    MO::ConstraintBlocks blocks;
+    for (int run = 0; run < 2; ++run)
+    {
+        state.mo->getConstraintBlocks(vector<unsigned int>(indices.begin(), indices.end()), blocks);
+        EXPECT_EQ(blocks.nbLines, 4u);
+        EXPECT_EQ(blocks.blockSize, 3u);
+        EXPECT_EQ(blocks.columns, vector<unsigned int>({0, 1, 2, 3}));
+        ASSERT_EQ(blocks.blockBegin.size(), reference.size() + 1);
+
+        std::size_t b = 0;
+        for (MO::ConstraintBlock& block : reference)
+        {
+            EXPECT_EQ(block.getColumn(), blocks.columns[b]);
+            const sofa::defaulttype::BaseMatrix* m = block.getMatrix();
+            std::vector<bool> nonZero(indices.size(), false);
+            for (unsigned int e = blocks.blockBegin[b]; e < blocks.blockBegin[b + 1]; ++e)
+            {
+                nonZero[blocks.lines[e]] = true;
+                for (unsigned int i = 0; i < 3; ++i)
+                    EXPECT_EQ(m->element(blocks.lines[e], i), blocks.values[e * 3 + i]);
+            }
+            for (unsigned int line = 0; line < indices.size(); ++line)
+                if (!nonZero[line])
+                    for (unsigned int i = 0; i < 3; ++i)
+                        EXPECT_EQ(m->element(line, i), 0.0);
+            ++b;
+        }
+    }
+
+    for (MO::ConstraintBlock& block : reference)
+        delete block.getMatrix();
+}
+
+/// vAlloc reuses the buffer of a freed temporary vector, reset to zero unless vAllocNoInit is set.
+TEST_F(MechanicalObjectVec3_test, vAllocReusesFreedBuffers)
+{
+    using sofa::core::VecDerivId;
+
+    State<Vec3Types> state(50, generator);
+    MO& mo = *state.mo;
+    const VecDerivId a(VecDerivId::V_FIRST_DYNAMIC_INDEX);
+    const VecDerivId b(VecDerivId::V_FIRST_DYNAMIC_INDEX + 1);
+
+    mo.vAlloc(params(), a);
+    mo.write(a)->beginEdit()->assign(50, Vec3Types::Deriv(1, 2, 3));
+    mo.write(a)->endEdit();
+    const Vec3Types::Deriv* buffer = mo.read(a)->getValue().data();
+    mo.vFree(params(), a);
+    EXPECT_EQ(mo.d_vectorPoolBytes.getValue(), 50 * sizeof(Vec3Types::Deriv));
+
+    mo.vAlloc(params(), b);
+    EXPECT_EQ(mo.read(b)->getValue().data(), buffer);
+    EXPECT_EQ(mo.read(b)->getValue(), VecDeriv(50, Vec3Types::Deriv()));
+    EXPECT_EQ(mo.d_vectorPoolHits.getValue(), 1u);
+    EXPECT_EQ(mo.d_vectorPoolBytes.getValue(), 0u);
+
+    // the values are kept with vAllocNoInit
+    mo.write(b)->beginEdit()->assign(50, Vec3Types::Deriv(4, 5, 6));
+    mo.write(b)->endEdit();
+    mo.vFree(params(), b);
+    mo.d_vAllocNoInit.setValue(true);
+    mo.vAlloc(params(), a);
+    EXPECT_EQ(mo.read(a)->getValue().data(), buffer);
+    EXPECT_EQ(mo.read(a)->getValue(), VecDeriv(50, Vec3Types::Deriv(4, 5, 6)));
+    EXPECT_EQ(mo.d_vectorPoolHits.getValue(), 2u);
+
+    // without pool, a freed vector releases its values
+    mo.d_vectorPool.setValue(false);
+    mo.vFree(params(), a);
+    EXPECT_EQ(mo.d_vectorPoolBytes.getValue(), 0u);
+    mo.vAlloc(params(), b);
+    EXPECT_EQ(mo.read(b)->getValue(), VecDeriv(50, Vec3Types::Deriv()));
+    EXPECT_EQ(mo.d_vectorPoolHits.getValue(), 2u);
+}
+
+/// The DOFs edited by replaceValue and swapValues are recorded, and an edit not recorded marks the whole vector.
+TEST_F(MechanicalObjectVec3_test, dirtyRanges)
+{
+    using sofa::core::ConstVecCoordId;
+    typedef std::vector<DirtyRanges::Range> Ranges;
+
+    State<Vec3Types> state(20, generator);
+    MO& mo = *state.mo;
+    const ConstVecCoordId x = ConstVecCoordId::position();
+
+    // without tracking, the whole vector is dirty
+    EXPECT_EQ(mo.getDirtyRanges(x).getRanges(), Ranges({{0, 20}}));
+
+    mo.d_trackDirtyRanges.setValue(true);
+    mo.clearDirtyRanges(x);
+    EXPECT_TRUE(mo.getDirtyRanges(x).empty());
+
+    mo.replaceValue(2, 7);
+    mo.swapValues(5, 3);
+    EXPECT_EQ(mo.getDirtyRanges(x).getRanges(), Ranges({{3, 4}, {5, 6}, {7, 8}}));
+
+    mo.clearDirtyRanges(x);
+    mo.writePositions()[4] = Vec3Types::Coord(1, 2, 3);
+    EXPECT_EQ(mo.getDirtyRanges(x).getRanges(), Ranges({{0, 20}}));
+}
+
+/// computeBBox gives the bounds of the positions, computed again when they change, also in parallel.
+TEST_F(MechanicalObjectVec3_test, computeBBoxFollowsPositions)
+{
+    State<Vec3Types> state(1000, generator);
+    MO& mo = *state.mo;
+    mo.d_parallelGrainSize.setValue(100);
+
+    auto expectBounds = [&mo](const VecCoord& x)
+    {
+        Vec3Types::Coord min = x[0], max = x[0];
+        for (const Vec3Types::Coord& p : x)
+            for (int c = 0; c < 3; ++c)
+            {
+                min[c] = std::min(min[c], p[c]);
+                max[c] = std::max(max[c], p[c]);
+            }
+        mo.computeBBox(params());
+        const sofa::defaulttype::BoundingBox& bbox = mo.f_bbox.getValue();
+        for (int c = 0; c < 3; ++c)
+        {
+            EXPECT_EQ(bbox.minBBox()[c], min[c]);
+            EXPECT_EQ(bbox.maxBBox()[c], max[c]);
+        }
+    };
+
+    expectBounds(state.positions());
+    expectBounds(state.positions()); // from the cache
+
+    mo.writePositions()[500] = Vec3Types::Coord(100, -100, 0);
+    expectBounds(state.positions());
+
+    mo.resize(10);
+    expectBounds(state.positions());
+}
+
+}  // namespace nodephysics::test
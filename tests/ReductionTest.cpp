@@ -0,0 +1,82 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include <SofaTest/Sofa_test.h>
+
+#include <NodePhysics/Reduction.h>
+#include <NodePhysics/TaskPool.h>
+
+namespace nodephysics::test
+{
+
+struct Reduction_test : public sofa::helper::testing::BaseTest
+{
+    std::vector<double> values;
+
+    void SetUp() override
+    {
+        // values of very different magnitudes, so that the association order changes the result
+        std::mt19937 generator(7);
+        std::uniform_real_distribution<double> mantissa(-1.0, 1.0);
+        std::uniform_int_distribution<int> exponent(-20, 20);
+        values.resize(13 * reduction::ChunkSize + 123);
+        for (double& v : values)
+            v = std::ldexp(mantissa(generator), exponent(generator));
+    }
+
+    double deterministicSum(bool parallel) const
+    {
+        return reduction::sum(values.size(), true, parallel, [this](std::size_t i) { return values[i]; });
+    }
+};
+
+/// The deterministic sum does not depend on the number of threads running it.
+TEST_F(Reduction_test, deterministicSumIsThreadCountInvariant)
+{
+    const double reference = deterministicSum(false);
+    for (int run = 0; run < 10; ++run)
+        EXPECT_EQ(deterministicSum(true), reference);
+
+    // a batch nested in a task runs on the calling thread, also when the outer batch runs inline
+    double nested = 0.0;
+    TaskPool::getInstance().run(1, [&](std::size_t) { nested = deterministicSum(true); });
+    EXPECT_EQ(nested, reference);
+}
+
+/// Without parallelism, the fast sum adds the values in order.
+TEST_F(Reduction_test, fastSumIsSequentialWithoutParallelism)
+{
+    double reference = 0.0;
+    for (double v : values)
+        reference += v;
+    EXPECT_EQ(reduction::sum(values.size(), false, false, [this](std::size_t i) { return values[i]; }), reference);
+}
+
+/// The deterministic sum is the pairwise sum of the compensated sums of fixed chunks.
+TEST_F(Reduction_test, deterministicSumMatchesChunkedReference)
+{
+    const std::size_t nbChunks = (values.size() + reduction::ChunkSize - 1) / reduction::ChunkSize;
+    std::vector<double> partials(nbChunks);
+    for (std::size_t c = 0; c < nbChunks; ++c)
+    {
+        const std::size_t end = std::min(values.size(), (c + 1) * reduction::ChunkSize);
+        partials[c] = reduction::compensatedSum(c * reduction::ChunkSize, end, [this](std::size_t i) { return values[i]; });
+    }
+    EXPECT_EQ(deterministicSum(true), reduction::pairwiseSum(partials.data(), nbChunks));
+}
+
+/// The maximum is exact whatever the number of threads.
+TEST_F(Reduction_test, maxIsThreadCountInvariant)
+{
+    auto f = [this](std::size_t i) { return std::abs(values[i]); };
+    double reference = 0.0;
+    for (std::size_t i = 0; i < values.size(); ++i)
+        reference = std::max(reference, f(i));
+
+    EXPECT_EQ(reduction::max(values.size(), 0.0, true, f), reference);
+    EXPECT_EQ(reduction::max(values.size(), 0.0, false, f), reference);
+}
+
+}  // namespace nodephysics::test
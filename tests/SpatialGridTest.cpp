@@ -0,0 +1,115 @@
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <utility>
+#include <vector>
+
+#include <SofaTest/Sofa_test.h>
+
+#include <NodePhysics/SpatialGrid.h>
+
+namespace nodephysics::test
+{
+
+/// Grid over random points, and the brute force answers of the queries.
+struct SpatialGrid_test : public sofa::helper::testing::BaseTest
+{
+    std::vector<double> points;
+    SpatialGrid grid;
+
+    void SetUp() override
+    {
+        // a dense cluster and a few far points, so that the cells are unevenly filled
+        std::mt19937 generator(5);
+        std::uniform_real_distribution<double> d(-1.0, 1.0);
+        for (int i = 0; i < 2000; ++i)
+            points.push_back(i % 100 == 0 ? 20 * d(generator) : d(generator));
+        points.resize(points.size() / 3 * 3);
+        grid.build(points);
+    }
+
+    double distance2(std::size_t i, const double p[3]) const
+    {
+        double d2 = 0;
+        for (int a = 0; a < 3; ++a)
+            d2 += (points[3 * i + a] - p[a]) * (points[3 * i + a] - p[a]);
+        return d2;
+    }
+};
+
+/// The box query returns the points inside the box, bounds included, in increasing order.
+TEST_F(SpatialGrid_test, queryBoxMatchesBruteForce)
+{
+    const double boxes[3][2][3] = { {{-0.5, -0.5, -0.5}, {0.5, 0.5, 0.5}},
+                                    {{0.0, -30.0, -1.0}, {30.0, 0.0, 1.0}},
+                                    {{5.0, 5.0, 5.0}, {4.0, 6.0, 6.0}} }; // empty
+    for (const auto& box : boxes)
+    {
+        std::vector<unsigned int> expected;
+        for (std::size_t i = 0; i < grid.getNbPoints(); ++i)
+        {
+            bool inside = true;
+            for (int a = 0; a < 3; ++a)
+                inside = inside && points[3 * i + a] >= box[0][a] && points[3 * i + a] <= box[1][a];
+            if (inside)
+                expected.push_back((unsigned int)i);
+        }
+
+        std::vector<unsigned int> indices;
+        grid.queryBox(box[0], box[1], indices);
+        EXPECT_EQ(indices, expected);
+    }
+}
+
+/// The nearest neighbors are found also far from the points and across sparse cells.
+TEST_F(SpatialGrid_test, queryNearestMatchesBruteForce)
+{
+    const double queries[3][3] = { {0.1, 0.2, -0.3}, {15.0, -15.0, 0.0}, {100.0, 100.0, 100.0} };
+    for (const auto& p : queries)
+    {
+        std::vector< std::pair<double, unsigned int> > expected;
+        for (std::size_t i = 0; i < grid.getNbPoints(); ++i)
+            expected.emplace_back(distance2(i, p), (unsigned int)i);
+        std::sort(expected.begin(), expected.end());
+        expected.resize(10);
+
+        std::vector< std::pair<double, unsigned int> > nearest;
+        grid.queryNearest(p, 10, nearest);
+        ASSERT_EQ(nearest.size(), expected.size());
+        for (std::size_t k = 0; k < nearest.size(); ++k)
+            EXPECT_EQ(nearest[k].first, expected[k].first) << "neighbor " << k;
+    }
+}
+
+/// The cone query returns a superset of the points inside the cone.
+TEST_F(SpatialGrid_test, queryConeContainsPointsInCone)
+{
+    const double origin[3] = {-3.0, 0.1, 0.0};
+    const double direction[3] = {1.0, 0.0, 0.0};
+    const double radius0 = 0.05, dRadius = 0.02;
+
+    std::vector<unsigned int> indices;
+    ASSERT_TRUE(grid.queryCone(origin, direction, radius0, dRadius, indices));
+    EXPECT_TRUE(std::is_sorted(indices.begin(), indices.end()));
+    EXPECT_LT(indices.size(), grid.getNbPoints());
+
+    std::size_t nbInside = 0;
+    for (std::size_t i = 0; i < grid.getNbPoints(); ++i)
+    {
+        double t = 0;
+        for (int a = 0; a < 3; ++a)
+            t += (points[3 * i + a] - origin[a]) * direction[a];
+        const double axisDistance2 = distance2(i, origin) - t * t;
+        if (t < 0 || axisDistance2 > (radius0 + dRadius * t) * (radius0 + dRadius * t))
+            continue;
+        ++nbInside;
+        EXPECT_TRUE(std::binary_search(indices.begin(), indices.end(), (unsigned int)i)) << "point " << i;
+    }
+    EXPECT_GT(nbInside, 0u);
+
+    // not normalized: the grid does not help
+    const double notNormalized[3] = {2.0, 0.0, 0.0};
+    EXPECT_FALSE(grid.queryCone(origin, notNormalized, radius0, dRadius, indices));
+}
+
+}  // namespace nodephysics::test
@@ -0,0 +1,144 @@
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+#include <SofaTest/Sofa_test.h>
+#include <sofa/defaulttype/VecTypes.h>
+#include <sofa/simulation/AnimateEndEvent.h>
+
+#include <NodePhysics/MechanicalObject.h>
+#include <NodePhysics/TrajectoryRecorder.h>
+
+namespace nodephysics::test
+{
+
+using sofa::defaulttype::Vec3Types;
+
+struct TrajectoryRecorder_test : public sofa::helper::testing::BaseTest
+{
+    std::string filename {"TrajectoryRecorder_test.trj"};
+
+    void TearDown() override
+    {
+        std::remove(filename.c_str());
+    }
+
+    std::vector<char> readFile() const
+    {
+        std::ifstream in(filename, std::ios::binary);
+        return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+    }
+
+    template <class T>
+    static T readValue(const std::vector<char>& file, std::size_t offset)
+    {
+        T value;
+        std::memcpy(&value, file.data() + offset, sizeof(T));
+        return value;
+    }
+};
+
+/// The records are written after the header, in order, and counted in the prefix of the file.
+TEST_F(TrajectoryRecorder_test, writerRoundTrip)
+{
+    const std::vector<char> header {'a', 'b', 'c'};
+    TrajectoryWriter writer;
+    ASSERT_TRUE(writer.open(filename, header, 4, 0));
+    for (char r = 0; r < 3; ++r)
+    {
+        char* p = writer.acquire(8);
+        ASSERT_NE(p, nullptr);
+        std::memset(p, r + 1, 8);
+        writer.commit();
+    }
+    writer.close();
+    EXPECT_EQ(writer.getNbRecords(), 3u);
+    EXPECT_EQ(writer.getNbDropped(), 0u);
+    EXPECT_FALSE(writer.hasFailed());
+
+    const std::vector<char> file = readFile();
+    ASSERT_EQ(file.size(), 40u + 3 * 8);
+    EXPECT_EQ(std::string(file.data(), 8), "NPHYSTRJ");
+    EXPECT_EQ(readValue<std::uint64_t>(file, 16), 3u);
+    EXPECT_EQ(readValue<std::uint64_t>(file, 24), file.size());
+    EXPECT_EQ(std::string(file.data() + 32, 3), "abc");
+    for (std::size_t r = 0; r < 3; ++r)
+        EXPECT_EQ(file[40 + r * 8], char(r + 1));
+}
+
+/// A large capacity is not reserved at once, and the file still grows past the initial reservation.
+TEST_F(TrajectoryRecorder_test, writerCapsInitialReservation)
+{
+    TrajectoryWriter writer;
+    ASSERT_TRUE(writer.open(filename, std::vector<char>(), 2, std::size_t(1) << 40));
+    {
+        std::ifstream in(filename, std::ios::binary | std::ios::ate);
+        EXPECT_LE((std::size_t)in.tellg(), std::size_t(64) << 20);
+    }
+
+    const std::size_t nbBytes = std::size_t(48) << 20;
+    for (int r = 0; r < 2; ++r)
+    {
+        char* p = nullptr;
+        while ((p = writer.acquire(nbBytes)) == nullptr) {}
+        std::memset(p, 0, nbBytes);
+        writer.commit();
+    }
+    writer.close();
+    EXPECT_EQ(writer.getNbRecords(), 2u);
+    EXPECT_FALSE(writer.hasFailed());
+    std::ifstream in(filename, std::ios::binary | std::ios::ate);
+    EXPECT_EQ((std::size_t)in.tellg(), 32 + 2 * nbBytes);
+}
+
+/// Each step records one DOF out of stride, after the index of the vector, the stride and the number of values.
+TEST_F(TrajectoryRecorder_test, recordsStridedPositions)
+{
+    typedef MechanicalObject<Vec3Types> MO;
+    MO::SPtr mo = sofa::core::objectmodel::New<MO>();
+    mo->resize(5);
+    {
+        sofa::helper::WriteAccessor< Data<Vec3Types::VecCoord> > x = mo->writePositions();
+        for (std::size_t i = 0; i < x.size(); ++i)
+            x[i] = Vec3Types::Coord(i, 2 * i, 3 * i);
+    }
+
+    TrajectoryRecorder<Vec3Types>::SPtr recorder = sofa::core::objectmodel::New< TrajectoryRecorder<Vec3Types> >();
+    recorder->l_mstate.set(mo.get());
+    recorder->d_filename.setValue(filename);
+    recorder->d_strides.setValue(sofa::helper::vector<unsigned int>(1, 2));
+    recorder->init();
+
+    sofa::simulation::AnimateEndEvent event(0.01);
+    for (int step = 0; step < 3; ++step)
+        recorder->handleEvent(&event);
+    recorder->cleanup();
+    EXPECT_EQ(recorder->d_nbRecords.getValue() + recorder->d_nbDropped.getValue(), 3u);
+
+    const std::vector<char> file = readFile();
+    ASSERT_GE(file.size(), 32u);
+    const std::uint64_t nbRecords = readValue<std::uint64_t>(file, 16);
+    EXPECT_EQ(nbRecords, recorder->d_nbRecords.getValue());
+    ASSERT_EQ(readValue<std::uint64_t>(file, 24), file.size());
+
+    // 3 values of 3 doubles per record, padded to 8 bytes
+    const std::size_t recordSize = 32 + 3 * sizeof(Vec3Types::Coord);
+    std::size_t offset = file.size() - nbRecords * recordSize;
+    for (std::uint64_t r = 0; r < nbRecords; ++r, offset += recordSize)
+    {
+        EXPECT_EQ(readValue<std::uint32_t>(file, offset), 0u);
+        EXPECT_EQ(readValue<std::uint32_t>(file, offset + 4), 2u);
+        EXPECT_EQ(readValue<std::uint64_t>(file, offset + 24), 3u);
+        for (std::size_t i = 0; i < 3; ++i)
+        {
+            const Vec3Types::Coord c = readValue<Vec3Types::Coord>(file, offset + 32 + i * sizeof(Vec3Types::Coord));
+            EXPECT_EQ(c, Vec3Types::Coord(2 * i, 4 * i, 6 * i));
+        }
+    }
+}
+
+}  // namespace nodephysics::test
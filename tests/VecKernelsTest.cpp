@@ -0,0 +1,66 @@
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include <SofaTest/Sofa_test.h>
+
+#include <NodePhysics/VecKernels.h>
+
+namespace nodephysics::test
+{
+
+template <class Real>
+struct VecKernels_test : public sofa::helper::testing::BaseTest
+{
+    /// Bounds of the points of v, ignoring NaN values, starting from the given min and max.
+    static void referenceBounds(const std::vector<Real>& v, std::size_t dim, Real* min, Real* max)
+    {
+        for (std::size_t i = 0; i < v.size(); ++i)
+        {
+            if (std::isnan(v[i]))
+                continue;
+            min[i % dim] = std::min(min[i % dim], v[i]);
+            max[i % dim] = std::max(max[i % dim], v[i]);
+        }
+    }
+};
+
+typedef ::testing::Types<double, float> RealTypes;
+TYPED_TEST_CASE(VecKernels_test, RealTypes);
+
+/// bounds gives the scalar bounds for all dimensions, for point counts which are not a multiple of the packs.
+TYPED_TEST(VecKernels_test, boundsMatchesReference)
+{
+    typedef TypeParam Real;
+    std::mt19937 generator(3);
+    std::uniform_real_distribution<double> d(-100.0, 100.0);
+
+    for (std::size_t dim = 1; dim <= 3; ++dim)
+    {
+        for (std::size_t nbPoints : {1u, 3u, 8u, 17u, 1001u})
+        {
+            std::vector<Real> v(nbPoints * dim);
+            for (Real& x : v)
+                x = (Real)d(generator);
+            if (nbPoints > 3)
+                v[dim + dim - 1] = std::numeric_limits<Real>::quiet_NaN();
+
+            Real min[3] = {v[0], v[dim > 1 ? 1 : 0], v[dim > 2 ? 2 : 0]};
+            Real max[3] = {min[0], min[1], min[2]};
+            Real expectedMin[3] = {min[0], min[1], min[2]};
+            Real expectedMax[3] = {max[0], max[1], max[2]};
+            this->referenceBounds(v, dim, expectedMin, expectedMax);
+
+            nodephysics::kernels::bounds(v.data(), nbPoints, dim, min, max);
+            for (std::size_t c = 0; c < dim; ++c)
+            {
+                EXPECT_EQ(min[c], expectedMin[c]) << "dim " << dim << ", " << nbPoints << " points";
+                EXPECT_EQ(max[c], expectedMax[c]) << "dim " << dim << ", " << nbPoints << " points";
+            }
+        }
+    }
+}
+
+}  // namespace nodephysics::test